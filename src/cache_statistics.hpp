@@ -0,0 +1,108 @@
+#ifndef CACHE_STATISTICS_HPP
+#define CACHE_STATISTICS_HPP
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <type_traits>
+
+namespace sk {
+
+///
+/// Counters kept by a `CachedResource` with `Traits::statistics`, see
+/// `CachedResource::getStatistics`. Can be printed with `sk::format`.
+///
+struct CacheStatistics
+{
+    // Calls to either `reduceTo` and the calls to the reducing function, or
+    // to the visitor, they made themselves. Caches they had to build are
+    // counted below
+    std::size_t reduces{ 0 };
+    std::size_t reduceCombines{ 0 };
+    std::size_t maxReduceCombines{ 0 };
+
+    // Every cache that was added, in the background or not, and every one
+    // that was removed by folding, undo, thinning or `removeIf`
+    std::size_t cachesBuilt{ 0 };
+    std::size_t cachesEvicted{ 0 };
+
+    std::size_t undos{ 0 };
+    std::size_t redos{ 0 };
+    std::size_t seeks{ 0 };
+    // Most elements that could be redone at once
+    std::size_t maxUndoDepth{ 0 };
+
+    // The state when the statistics were taken
+    std::size_t undoDepth{ 0 };
+    std::size_t elements{ 0 };
+    std::size_t caches{ 0 };
+    std::size_t cacheBytes{ 0 };
+    std::size_t bytes{ 0 };
+
+    [[nodiscard]] auto combinesPerReduce() const noexcept -> double
+    {
+        return reduces == 0 ? 0.0
+                            : static_cast<double>(reduceCombines) /
+                                  static_cast<double>(reduces);
+    }
+
+    friend auto operator<<(std::ostream& os, CacheStatistics const& s)
+        -> std::ostream&
+    {
+        os << "reduces=" << s.reduces
+           << " combinesPerReduce=" << s.combinesPerReduce()
+           << " maxReduceCombines=" << s.maxReduceCombines
+           << " cachesBuilt=" << s.cachesBuilt
+           << " cachesEvicted=" << s.cachesEvicted << " undos=" << s.undos
+           << " redos=" << s.redos << " seeks=" << s.seeks
+           << " undoDepth=" << s.undoDepth
+           << " maxUndoDepth=" << s.maxUndoDepth
+           << " elements=" << s.elements << " caches=" << s.caches
+           << " cacheBytes=" << s.cacheBytes << " bytes=" << s.bytes;
+
+        return os;
+    }
+};
+
+namespace impl {
+
+inline constexpr std::size_t costBuckets = 16;
+
+struct NoCounters
+{
+};
+
+struct StatisticsCounters
+{
+    CacheStatistics m_statistics{};
+};
+
+struct EmplaceCostCounters
+{
+    // Calls to the reducing function made while building caches or folding
+    std::size_t m_combines{ 0 };
+    std::array<std::size_t, costBuckets> m_emplaceCosts{};
+};
+
+struct AllCounters
+    : StatisticsCounters
+    , EmplaceCostCounters
+{
+};
+
+///
+/// Base of a `CachedResource` holding the counters it keeps. A single class
+/// so it's empty, and takes no space at all, when they're all disabled.
+///
+template<bool Statistics, bool EmplaceCosts>
+using Counters = std::conditional_t<
+    Statistics,
+    std::conditional_t<EmplaceCosts, AllCounters, StatisticsCounters>,
+    std::conditional_t<EmplaceCosts, EmplaceCostCounters, NoCounters>>;
+
+} // namespace impl
+
+} // namespace sk
+
+#endif // !CACHE_STATISTICS_HPP
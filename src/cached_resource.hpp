@@ -2,93 +2,1751 @@
 #define CACHED_RESOURCE_HPP
 #pragma once
 
+#include "cache_statistics.hpp"
+#include "ring_buffer.hpp"
+#include "thread_pool.hpp"
+
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
 #include <deque>
 #include <functional>
+#include <future>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace sk {
 
+namespace impl {
+
+template<typename Traits, typename T, typename = void>
+struct HasSizeOf : std::false_type
+{
+};
+
+template<typename Traits, typename T>
+struct HasSizeOf<
+    Traits,
+    T,
+    std::void_t<decltype(Traits::sizeOf(std::declval<T const&>()))>>
+    : std::true_type
+{
+};
+
+template<typename Traits, typename T>
+[[nodiscard]] auto bytesOf(T const& value) -> std::size_t
+{
+    if constexpr(HasSizeOf<Traits, T>::value) {
+        return Traits::sizeOf(value);
+    }
+    else {
+        static_cast<void>(value);
+        return sizeof(T);
+    }
+}
+
+template<typename Traits, typename = void>
+struct MaxBytes
+{
+    static constexpr std::size_t value =
+        std::numeric_limits<std::size_t>::max();
+};
+
+template<typename Traits>
+struct MaxBytes<Traits, std::void_t<decltype(Traits::maxBytes)>>
+{
+    static constexpr std::size_t value = Traits::maxBytes;
+};
+
+template<typename Traits, typename = void>
+struct Hierarchical : std::false_type
+{
+};
+
+template<typename Traits>
+struct Hierarchical<Traits, std::void_t<decltype(Traits::hierarchical)>>
+    : std::bool_constant<Traits::hierarchical>
+{
+};
+
+template<typename Traits, typename = void>
+struct LazyCaches : std::false_type
+{
+};
+
+template<typename Traits>
+struct LazyCaches<Traits, std::void_t<decltype(Traits::lazyCaches)>>
+    : std::bool_constant<Traits::lazyCaches>
+{
+};
+
+template<typename Traits, typename = void>
+struct BackgroundCaches : std::false_type
+{
+};
+
+template<typename Traits>
+struct BackgroundCaches<Traits,
+                        std::void_t<decltype(Traits::backgroundCaches)>>
+    : std::bool_constant<Traits::backgroundCaches>
+{
+};
+
+template<typename Traits, typename T, typename = void>
+struct HasInverse : std::false_type
+{
+};
+
+template<typename Traits, typename T>
+struct HasInverse<Traits,
+                  T,
+                  std::void_t<decltype(Traits::inverse(std::declval<T&>(),
+                                                       std::declval<T&>()))>>
+    : std::true_type
+{
+};
+
+template<typename Traits, typename = void>
+struct UndoTree : std::false_type
+{
+};
+
+template<typename Traits>
+struct UndoTree<Traits, std::void_t<decltype(Traits::undoTree)>>
+    : std::bool_constant<Traits::undoTree>
+{
+};
+
+template<typename Traits, typename = void>
+struct Associative : std::false_type
+{
+};
+
+template<typename Traits>
+struct Associative<Traits, std::void_t<decltype(Traits::associative)>>
+    : std::bool_constant<Traits::associative>
+{
+};
+
+template<typename Traits, typename = void>
+struct Statistics : std::false_type
+{
+};
+
+template<typename Traits>
+struct Statistics<Traits, std::void_t<decltype(Traits::statistics)>>
+    : std::bool_constant<Traits::statistics>
+{
+};
+
+template<typename Traits, typename = void>
+struct ParallelThreshold : std::integral_constant<std::size_t, 64>
+{
+};
+
+template<typename Traits>
+struct ParallelThreshold<Traits,
+                         std::void_t<decltype(Traits::parallelThreshold)>>
+    : std::integral_constant<std::size_t, Traits::parallelThreshold>
+{
+};
+
+template<typename Traits, typename = void>
+struct TargetLatency
+{
+    static constexpr bool adaptive = false;
+    static constexpr std::chrono::nanoseconds value{ 0 };
+};
+
+template<typename Traits>
+struct TargetLatency<Traits, std::void_t<decltype(Traits::targetLatency)>>
+{
+    static constexpr bool adaptive = true;
+    static constexpr std::chrono::nanoseconds value =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Traits::targetLatency);
+};
+
+///
+/// Emplace costs are kept whenever caches are built on their own schedule,
+/// adaptive or lazy, and whenever statistics are.
+///
+template<typename Traits>
+struct EmplaceCosts
+    : std::bool_constant<TargetLatency<Traits>::adaptive ||
+                         LazyCaches<Traits>::value || Statistics<Traits>::value>
+{
+};
+
+///
+/// Containers that keep only part of their elements in memory, like
+/// `SpillBuffer`. `trim(keepFrom)` may move anything before `keepFrom` out.
+///
+template<typename Container, typename = void>
+struct Spillable : std::false_type
+{
+};
+
+template<typename Container>
+struct Spillable<Container,
+                 std::void_t<decltype(std::declval<Container&>().trim(
+                     std::size_t{}))>> : std::true_type
+{
+};
+
+///
+/// Allocator of an allocator aware container, `std::allocator<T>` for the
+/// others so there's always something to pass around.
+///
+template<typename Container, typename T, typename = void>
+struct AllocatorOf
+{
+    using type = std::allocator<T>;
+    static constexpr bool aware = false;
+};
+
+template<typename Container, typename T>
+struct AllocatorOf<Container,
+                   T,
+                   std::void_t<typename Container::allocator_type>>
+{
+    using type = typename Container::allocator_type;
+    static constexpr bool aware = true;
+};
+
+///
+/// Element type of a reducing function, used by the deduction guides. Only
+/// works for functions and functors with a single non-template call operator.
+///
+template<typename F, typename = void>
+struct ReducedType
+{
+};
+
+template<typename T>
+struct ReducedType<void (*)(T&, T&)>
+{
+    using type = T;
+};
+
+template<typename T, typename C>
+struct ReducedType<void (C::*)(T&, T&) const>
+{
+    using type = T;
+};
+
+template<typename T, typename C>
+struct ReducedType<void (C::*)(T&, T&) const noexcept>
+{
+    using type = T;
+};
+
+template<typename F>
+struct ReducedType<F, std::void_t<decltype(&F::operator())>>
+    : ReducedType<decltype(&F::operator())>
+{
+};
+
+template<typename Traits, typename = void>
+struct HasDelta : std::false_type
+{
+};
+
+template<typename Traits>
+struct HasDelta<Traits, std::void_t<typename Traits::DeltaType>>
+    : std::true_type
+{
+};
+
+///
+/// Stores the caches of a `CachedResource` as the first one plus the
+/// difference between every pair of neighbours, see `Traits::DeltaType`.
+///
+/// A single cache is kept whole at a time, indexing walks it through the
+/// deltas to the one asked for. That is O(1) for what `CachedResource` does
+/// in a row (the last cache, or the one before or after it).
+///
+template<typename T, typename Traits>
+class DeltaCaches
+{
+private:
+    using Delta = typename Traits::DeltaType;
+
+    std::optional<T> m_first{};
+    RingBuffer<Delta> m_deltas{};
+    // Size of each cache when it was whole, for cost estimates
+    RingBuffer<std::size_t> m_fullBytes{};
+    std::size_t m_bytes{ 0 };
+
+    std::optional<T> m_current{};
+    std::size_t m_cursor{ 0 };
+
+    ///
+    /// \returns The cache at `index`, moving `m_current` there.
+    ///
+    auto moveTo(std::size_t const index) -> T&
+    {
+        auto const distance =
+            (m_cursor > index) ? m_cursor - index : index - m_cursor;
+
+        if(index < distance) {
+            m_current = m_first;
+            m_cursor = 0;
+        }
+
+        for(; m_cursor < index; ++m_cursor) {
+            Traits::applyDelta(*m_current, m_deltas[m_cursor]);
+        }
+        while(m_cursor > index) {
+            Traits::revertDelta(*m_current, m_deltas[--m_cursor]);
+        }
+
+        return *m_current;
+    }
+
+    auto addBytes(Delta const& delta) -> void
+    {
+        m_bytes += bytesOf<Traits>(delta);
+    }
+    auto removeBytes(Delta const& delta) -> void
+    {
+        m_bytes -= bytesOf<Traits>(delta);
+    }
+
+    auto replaceFirst(T value) -> void
+    {
+        if(m_first.has_value()) {
+            m_bytes -= bytesOf<Traits>(*m_first);
+        }
+
+        m_bytes += bytesOf<Traits>(value);
+        m_first = std::move(value);
+    }
+
+public:
+    [[nodiscard]] auto size() const noexcept -> std::size_t
+    {
+        return m_fullBytes.size();
+    }
+    [[nodiscard]] auto empty() const noexcept -> bool
+    {
+        return m_fullBytes.empty();
+    }
+
+    ///
+    /// \returns The bytes of the first cache and of every delta.
+    ///
+    [[nodiscard]] auto bytes() const noexcept -> std::size_t
+    {
+        return m_bytes;
+    }
+    [[nodiscard]] auto fullBytes(std::size_t const index) const noexcept
+        -> std::size_t
+    {
+        return m_fullBytes[index];
+    }
+
+    auto operator[](std::size_t const index) -> T&
+    {
+        return this->moveTo(index);
+    }
+    auto front() -> T&
+    {
+        return *m_first;
+    }
+    auto back() -> T&
+    {
+        return this->moveTo(this->size() - 1);
+    }
+
+    auto clear() -> void
+    {
+        m_first.reset();
+        m_current.reset();
+        m_deltas.clear();
+        m_fullBytes.clear();
+        m_bytes = 0;
+        m_cursor = 0;
+    }
+
+    auto push_back(T value) -> void
+    {
+        if(this->empty()) {
+            this->insert(0, std::move(value));
+            return;
+        }
+
+        auto& last = this->back();
+        auto delta = Traits::makeDelta(last, value);
+
+        this->addBytes(delta);
+        m_deltas.push_back(std::move(delta));
+        m_fullBytes.push_back(bytesOf<Traits>(value));
+
+        last = std::move(value);
+        ++m_cursor;
+    }
+
+    auto pop_back() -> void
+    {
+        if(this->size() == 1) {
+            this->clear();
+            return;
+        }
+
+        if(m_cursor + 1 == this->size()) {
+            static_cast<void>(this->moveTo(m_cursor - 1));
+        }
+
+        this->removeBytes(m_deltas.back());
+        m_deltas.pop_back();
+        m_fullBytes.pop_back();
+    }
+
+    auto pop_front() -> void
+    {
+        if(this->size() == 1) {
+            this->clear();
+            return;
+        }
+
+        T second{ *m_first };
+        Traits::applyDelta(second, m_deltas.front());
+
+        this->removeBytes(m_deltas.front());
+        m_deltas.pop_front();
+        m_fullBytes.pop_front();
+        this->replaceFirst(std::move(second));
+
+        if(m_cursor == 0) {
+            m_current = m_first;
+        }
+        else {
+            --m_cursor;
+        }
+    }
+
+    ///
+    /// Inserts `value` before the cache at `index`. The delta that crossed
+    /// the new cache is replaced by one on each side of it.
+    ///
+    auto insert(std::size_t const index, T value) -> void
+    {
+        auto const fullBytes = bytesOf<Traits>(value);
+
+        if(this->empty()) {
+            this->replaceFirst(value);
+            m_current = std::move(value);
+            m_cursor = 0;
+        }
+        else if(index == 0) {
+            auto delta = Traits::makeDelta(value, *m_first);
+
+            this->addBytes(delta);
+            m_deltas.push_front(std::move(delta));
+            this->replaceFirst(std::move(value));
+            ++m_cursor;
+        }
+        else if(index == this->size()) {
+            this->push_back(std::move(value));
+            return;
+        }
+        else {
+            T before{ this->moveTo(index - 1) };
+            auto& after = this->moveTo(index);
+
+            auto first = Traits::makeDelta(before, value);
+            auto second = Traits::makeDelta(value, after);
+
+            this->removeBytes(m_deltas[index - 1]);
+            this->addBytes(first);
+            this->addBytes(second);
+            m_deltas[index - 1] = std::move(first);
+            m_deltas.insert(
+                m_deltas.begin() + static_cast<std::ptrdiff_t>(index),
+                std::move(second));
+            ++m_cursor;
+        }
+
+        m_fullBytes.insert(
+            m_fullBytes.begin() + static_cast<std::ptrdiff_t>(index), fullBytes);
+    }
+
+    ///
+    /// Removes the cache at `index`, its neighbours get a single delta.
+    ///
+    auto erase(std::size_t const index) -> void
+    {
+        if(index == 0) {
+            this->pop_front();
+            return;
+        }
+        if(index + 1 == this->size()) {
+            this->pop_back();
+            return;
+        }
+
+        T before{ this->moveTo(index - 1) };
+        auto delta = Traits::makeDelta(before, this->moveTo(index + 1));
+
+        this->removeBytes(m_deltas[index - 1]);
+        this->removeBytes(m_deltas[index]);
+        this->addBytes(delta);
+        m_deltas[index - 1] = std::move(delta);
+        m_deltas.erase(m_deltas.begin() + static_cast<std::ptrdiff_t>(index));
+        m_fullBytes.erase(m_fullBytes.begin() +
+                          static_cast<std::ptrdiff_t>(index));
+        --m_cursor;
+    }
+};
+
+} // namespace impl
+
+///
+/// Besides the members below a traits type can also provide:
+///   - `static auto sizeOf(T const&) -> std::size_t`, the number of bytes an
+///     element holds. Defaults to `sizeof(T)`.
+///   - `static constexpr std::size_t maxBytes`, the budget for all the
+///     elements and caches together. Defaults to no limit.
+///   - `static constexpr auto targetLatency`, a `std::chrono::duration`.
+///     When present caches are no longer placed every `cacheGap` elements:
+///     the cost of the reducing function is measured at runtime and caches
+///     are spaced so that `reduceTo` stays under the target. `cacheGap` is
+///     only used until the first measurement.
+///   - `static constexpr bool hierarchical`. When true only O(log n) caches
+///     are kept: the ones close to the current position are `cacheGap`
+///     apart and the spacing doubles further away. Moving through the
+///     history builds the missing caches, which costs O(log n) calls to the
+///     reducing function per step on average.
+///   - `static constexpr bool lazyCaches`. When true `emplaceBack` never
+///     builds caches, they are built by `materialize` or by `reduceTo` once
+///     the replay gets twice as long as it normally would.
+///   - `static constexpr bool backgroundCaches`. When true caches are built
+///     on `sharedThreadPool()` from copies of the elements they cover and
+///     are published once they're done. Until then `reduceTo` replays from
+///     the previous cache. The reducing function must be safe to call from
+///     another thread and copying `T` should be cheap (e.g. implicitly
+///     shared types).
+///   - `static auto inverse(T& dest, T& src) -> void`, undoes
+///     `function(dest, src)`. When present no caches are kept at all, a
+///     single running reduction is moved one element at a time by
+///     `undo`/`redo`, so `reduceTo` always costs two calls. `maxCount` and
+///     `maxBytes` are enforced by folding the two oldest elements.
+///   - `using DeltaType`, together with
+///     `static auto makeDelta(T const& from, T const& to) -> DeltaType`,
+///     `static auto applyDelta(T& from, DeltaType const&) -> void` and
+///     `static auto revertDelta(T& to, DeltaType const&) -> void`. When
+///     present every cache but the first is stored as the difference from
+///     the one before it and rebuilt when needed, see `impl::DeltaCaches`.
+///     `sizeOf` can be overloaded for `DeltaType`.
+///   - `static constexpr bool undoTree`. When true `emplaceBack` under undo
+///     keeps the undone elements and their caches as a branch instead of
+///     destroying them. `switchBranch` makes a branch the current line, the
+///     line it replaces becomes a branch in turn. Branches count towards
+///     `maxBytes` and the least recently abandoned ones are dropped before
+///     anything gets folded.
+///   - `static constexpr bool associative`. When true `reduceTo(T&)` splits
+///     replays of at least `parallelThreshold` elements (64 by default) in
+///     chunks reduced on `sharedThreadPool()`, the partial results are then
+///     merged pairwise. The reducing function must be associative and safe
+///     to call from another thread. `reduceTo` must not be called from the
+///     shared pool itself.
+///   - `static constexpr bool statistics`. When true the counters in
+///     `CacheStatistics` are kept, see `getStatistics`. They cost nothing
+///     otherwise.
+///
+/// When `ContainerType` is allocator aware the resource can be constructed
+/// with an allocator, which is then used for the elements, the caches and the
+/// cache ends. `sk::pmr::ResourceTraits` does so with a
+/// `std::pmr::polymorphic_allocator`, so a document can give its histories a
+/// pooled or monotonic memory resource.
+///
+/// When `ContainerType` is a `SpillBuffer` the elements and caches that
+/// `reduceTo` doesn't need are trimmed after every change, only undoing past
+/// them brings them back in memory.
+///
 template<typename T>
 struct ResourceTraits
 {
-    using ContainerType = std::deque<T>;
+    using ContainerType = RingBuffer<T>;
     static constexpr int cacheGap = 5;
     static constexpr int maxCount = std::numeric_limits<int>::max();
 };
 
-template<typename T, typename Traits = ResourceTraits<T>>
+namespace pmr {
+
+///
+/// Same as `sk::ResourceTraits` but the elements, caches and cache ends are
+/// allocated from the `std::pmr::memory_resource` the resource is built with.
+///
+template<typename T>
+struct ResourceTraits : sk::ResourceTraits<T>
+{
+    using ContainerType = RingBuffer<T, std::pmr::polymorphic_allocator<T>>;
+};
+
+} // namespace pmr
+
+///
+/// `Function` is the reducing function, called as `function(dest, src)`. It
+/// defaults to a function pointer, a functor or lambda type lets the compiler
+/// inline it into the reduction loops. `src` is only read, neither it nor
+/// what `reduceTo` visitors are given may be changed.
+///
+template<typename T,
+         typename Traits = ResourceTraits<T>,
+         typename Function = void (*)(T&, T&)>
 class CachedResource
+    : private impl::Counters<impl::Statistics<Traits>::value,
+                             impl::EmplaceCosts<Traits>::value>
 {
+public:
+    using allocator_type =
+        typename impl::AllocatorOf<typename Traits::ContainerType, T>::type;
+
 private:
     using ContainerType = typename Traits::ContainerType;
-    using Iterator = typename ContainerType::iterator;
+    using CacheEnds = RingBuffer<
+        std::size_t,
+        typename std::allocator_traits<
+            allocator_type>::template rebind_alloc<std::size_t>>;
+    using Clock = std::chrono::steady_clock;
 
-    static constexpr auto m_cacheGap = Traits::cacheGap;
+    static constexpr auto m_cacheGap = static_cast<std::size_t>(Traits::cacheGap);
     static constexpr auto m_maxCount = Traits::maxCount;
+    static constexpr auto m_maxBytes = impl::MaxBytes<Traits>::value;
+    static constexpr auto m_adaptive = impl::TargetLatency<Traits>::adaptive;
+    static constexpr auto m_targetLatency =
+        static_cast<double>(impl::TargetLatency<Traits>::value.count());
+    static constexpr auto m_maxSpacing =
+        std::max(m_cacheGap, static_cast<std::size_t>(m_maxCount / 2));
+    static constexpr auto m_hierarchical = impl::Hierarchical<Traits>::value;
+    static constexpr auto m_lazy = impl::LazyCaches<Traits>::value;
+    static constexpr auto m_background = impl::BackgroundCaches<Traits>::value;
+    static constexpr auto m_invertible = impl::HasInverse<Traits, T>::value;
+    static constexpr auto m_deltaCaches = impl::HasDelta<Traits>::value;
+    static constexpr auto m_undoTree = impl::UndoTree<Traits>::value;
+    static constexpr auto m_associative = impl::Associative<Traits>::value;
+    static constexpr auto m_parallelThreshold =
+        impl::ParallelThreshold<Traits>::value;
+    static constexpr auto m_spillable = impl::Spillable<ContainerType>::value;
+    static constexpr auto m_collectStatistics = impl::Statistics<Traits>::value;
+    static constexpr auto m_keepCosts = impl::EmplaceCosts<Traits>::value;
+    static constexpr auto m_costBuckets = impl::costBuckets;
 
-    static_assert(m_cacheGap > 0, "The cache gap should be bigger than 0!");
+    static_assert(Traits::cacheGap > 0,
+                  "The cache gap should be bigger than 0!");
     static_assert(m_maxCount > 1, "The cache limit should be bigger than 1!");
+    static_assert(m_maxCount > Traits::cacheGap,
+                  "The cache limit should be bigger than the cache gap!");
+    static_assert(!(m_adaptive && m_hierarchical),
+                  "Adaptive and hierarchical caches can't be mixed!");
+    static_assert(!(m_lazy && m_hierarchical),
+                  "Lazy and hierarchical caches can't be mixed!");
+    static_assert(!m_background || !(m_adaptive || m_hierarchical || m_lazy),
+                  "Background caches only work with a fixed cache gap!");
+    static_assert(!m_invertible ||
+                      !(m_adaptive || m_hierarchical || m_lazy || m_background),
+                  "An inverse replaces the caches, no cache mode can be used!");
+    static_assert(!m_deltaCaches || !(m_undoTree || m_invertible),
+                  "Delta caches can't be used with an undo tree or inverse!");
+    static_assert(m_parallelThreshold > 1,
+                  "The parallel threshold should be bigger than 1!");
+
+    using CacheContainer = std::conditional_t<m_deltaCaches,
+                                              impl::DeltaCaches<T, Traits>,
+                                              ContainerType>;
 
     ContainerType m_data{};
-    ContainerType m_cache{};
+    CacheContainer m_cache{};
+    // `m_cache[i]` is the reduction of `m_data[0, m_cacheEnds[i])`
+    CacheEnds m_cacheEnds{};
+
+    // Number of elements/caches that are visible, everything past them can
+    // only be reached through redo
+    std::size_t m_dataLimit{ 0 };
+    std::size_t m_cacheLimit{ 0 };
 
-    Iterator m_dataLimit{};
-    Iterator m_cacheLimit{};
+    bool m_underUndo{ false };
+    bool m_folded{ false };
+
+    std::size_t m_bytes{ 0 };
+    // What was accounted for `m_data.back()`, the newest element is the only
+    // one that's allowed to change after it was emplaced
+    std::size_t m_lastBytes{ 0 };
+
+    // Measured cost of the reducing function, only used in adaptive mode
+    double m_nsPerByte{ 0.0 };
+    std::size_t m_rebalanceCursor{ 0 };
+
+    struct PendingCache
+    {
+        std::size_t end{ 0 };
+        // Only valid while a cache is being built
+        std::shared_future<T> value{};
+    };
+
+    // The cache being built in the background, only one at a time
+    PendingCache m_pending{};
+
+    struct Branch
+    {
+        // Number of elements shared with the line it hangs from
+        std::size_t fork{ 0 };
+        // When it was abandoned, older branches are dropped first
+        std::size_t age{ 0 };
+        // Elements past `fork` and the caches that end past it, the ends are
+        // relative to the whole line like `m_cacheEnds`
+        ContainerType data{};
+        ContainerType cache{};
+        CacheEnds cacheEnds{};
+        // Bytes of `data` and `cache`, not including `branches`
+        std::size_t bytes{ 0 };
+        // Branches that fork past `fork`
+        std::vector<Branch> branches{};
+    };
+
+    // Reduction of `m_data[0, m_runningEnd)`, only used with an inverse. Like
+    // a cache it never holds the last visible element
+    std::optional<T> m_running{};
+    std::size_t m_runningEnd{ 0 };
+    std::size_t m_runningBytes{ 0 };
+
+    // Branches hanging from the current line, only used with an undo tree
+    std::vector<Branch> m_branches{};
+    std::size_t m_branchAge{ 0 };
+
+    Function m_function{};
+
+    ///
+    /// \returns An empty container using `allocator`, if it takes one.
+    ///
+    template<typename Container>
+    [[nodiscard]] static auto makeContainer(allocator_type const& allocator)
+        -> Container
+    {
+        if constexpr(impl::AllocatorOf<Container, T>::aware) {
+            return Container(
+                typename Container::allocator_type{ allocator });
+        }
+        else {
+            static_cast<void>(allocator);
+            return Container{};
+        }
+    }
+
+    [[nodiscard]] static auto sizeOf(T const& value) -> std::size_t
+    {
+        if constexpr(impl::HasSizeOf<Traits, T>::value) {
+            return Traits::sizeOf(value);
+        }
+        else {
+            static_cast<void>(value);
+            return sizeof(T);
+        }
+    }
+
+    ///
+    /// \returns The element at `index` for reading. A spillable container is
+    ///          reached through its const accessor so it keeps the record of
+    ///          the element, the reducing function and `reduceTo` visitors
+    ///          take `src` as `T&` but don't change it.
+    ///
+    template<typename Container>
+    [[nodiscard]] static auto peek(Container& container,
+                                   std::size_t const index) -> T&
+    {
+        if constexpr(impl::Spillable<Container>::value) {
+            return const_cast<T&>(std::as_const(container)[index]);
+        }
+        else {
+            return container[index];
+        }
+    }
+
+    auto refreshLastBytes() -> void
+    {
+        m_bytes -= m_lastBytes;
+        m_lastBytes =
+            m_data.empty() ? 0 : sizeOf(std::as_const(m_data).back());
+        m_bytes += m_lastBytes;
+    }
+
+    [[nodiscard]] inline auto noCaches() const noexcept -> bool
+    {
+        return m_cacheLimit == 0;
+    }
+
+    [[nodiscard]] auto getIndexPastCache() const noexcept -> std::size_t
+    {
+        if constexpr(m_invertible) {
+            return m_runningEnd;
+        }
+        else {
+            return this->noCaches() ? 0 : m_cacheEnds[m_cacheLimit - 1];
+        }
+    }
+
+    ///
+    /// Lets a spillable container move out everything `reduceTo` won't
+    /// touch: the elements covered by the last visible cache and the caches
+    /// before it.
+    ///
+    auto trimResident() -> void
+    {
+        if constexpr(m_spillable) {
+            m_data.trim(this->getIndexPastCache());
+        }
+        if constexpr(impl::Spillable<CacheContainer>::value) {
+            m_cache.trim(this->noCaches() ? 0 : m_cacheLimit - 1);
+        }
+    }
+
+    ///
+    /// Moves the running reduction until it holds `m_data[0, end)`, one call
+    /// to the reducing function or to its inverse per element. Starts over
+    /// when that is cheaper than going back.
+    ///
+    auto moveRunning(std::size_t const end) -> void
+    {
+        if(end < m_runningEnd - std::min(end, m_runningEnd)) {
+            m_running.reset();
+            m_runningEnd = 0;
+        }
+
+        while(m_runningEnd > end) {
+            if(--m_runningEnd == 0) {
+                m_running.reset();
+            }
+            else {
+                Traits::inverse(*m_running, peek(m_data, m_runningEnd));
+            }
+        }
+
+        while(m_runningEnd < end) {
+            if(m_runningEnd == 0) {
+                m_running.emplace(peek(m_data, 0));
+            }
+            else {
+                m_function(*m_running, peek(m_data, m_runningEnd));
+            }
+
+            ++m_runningEnd;
+        }
+
+        m_bytes -= m_runningBytes;
+        m_runningBytes = m_running.has_value() ? sizeOf(*m_running) : 0;
+        m_bytes += m_runningBytes;
+    }
+
+    ///
+    /// Makes the running reduction hold every visible element but the last.
+    ///
+    auto syncRunning() -> void
+    {
+        this->moveRunning(m_dataLimit == 0 ? 0 : m_dataLimit - 1);
+    }
+
+    ///
+    /// Folds the two oldest elements into one, the running reduction stays
+    /// the same since it already holds both.
+    ///
+    auto foldInverse() -> void
+    {
+        auto base = std::move(m_data.front());
+        m_bytes -= sizeOf(base);
+        m_data.pop_front();
+
+        m_function(base, m_data.front());
+        this->countCombines(1);
+        m_bytes -= sizeOf(m_data.front());
+        m_data.pop_front();
+
+        m_bytes += sizeOf(base);
+        m_data.push_front(std::move(base));
+
+        --m_runningEnd;
+        m_dataLimit = m_data.size();
+        m_folded = true;
+
+        if constexpr(m_undoTree) {
+            this->shiftBranches(m_branches, 1);
+        }
+    }
+
+    auto recordUndoDepth() noexcept -> void
+    {
+        this->m_statistics.maxUndoDepth = std::max(
+            this->m_statistics.maxUndoDepth, m_data.size() - m_dataLimit);
+    }
+
+    auto updateCacheLimit() -> void
+    {
+        m_cacheLimit = static_cast<std::size_t>(std::distance(
+            m_cacheEnds.begin(),
+            std::upper_bound(
+                m_cacheEnds.begin(), m_cacheEnds.end(), m_dataLimit)));
+    }
+
+    ///
+    /// Counts a `reduceTo` that starts from the last cache, if `cached`, and
+    /// goes on with `m_data[first, m_dataLimit)`.
+    ///
+    auto countReduce(bool const cached, std::size_t const first) noexcept
+        -> void
+    {
+        if constexpr(m_collectStatistics) {
+            auto const combines =
+                (m_dataLimit - first) + (cached ? std::size_t{ 1 } : 0);
+
+            ++this->m_statistics.reduces;
+            this->m_statistics.reduceCombines += combines;
+            this->m_statistics.maxReduceCombines =
+                std::max(this->m_statistics.maxReduceCombines, combines);
+        }
+        else {
+            static_cast<void>(cached);
+            static_cast<void>(first);
+        }
+    }
+
+    ///
+    /// Emplace costs are only kept in adaptive or lazy mode, or with
+    /// statistics, everywhere else the helpers below do nothing.
+    ///
+    auto countCombines(std::size_t const count) noexcept -> void
+    {
+        if constexpr(m_keepCosts) {
+            this->m_combines += count;
+        }
+        else {
+            static_cast<void>(count);
+        }
+    }
+
+    [[nodiscard]] auto getCombines() const noexcept -> std::size_t
+    {
+        if constexpr(m_keepCosts) {
+            return this->m_combines;
+        }
+        else {
+            return 0;
+        }
+    }
+
+    ///
+    /// Records the cost of an emplace that started when `getCombines`
+    /// returned `since`.
+    ///
+    auto recordEmplaceCost(std::size_t const since) noexcept -> void
+    {
+        if constexpr(m_keepCosts) {
+            auto combines = this->m_combines - since;
+            std::size_t bucket{ 0 };
+
+            while(combines > 0 && bucket + 1 < m_costBuckets) {
+                combines >>= 1;
+                ++bucket;
+            }
+
+            ++this->m_emplaceCosts[bucket];
+        }
+        else {
+            static_cast<void>(since);
+        }
+    }
+
+    ///
+    /// Cache bookkeeping goes through the helpers below so the bytes stay
+    /// right with delta caches, where a cache's size depends on its
+    /// neighbours.
+    ///
+    auto pushCache(T value, std::size_t const end) -> void
+    {
+        if constexpr(m_deltaCaches) {
+            m_bytes -= m_cache.bytes();
+            m_cache.push_back(std::move(value));
+            m_bytes += m_cache.bytes();
+        }
+        else {
+            m_bytes += sizeOf(value);
+            m_cache.push_back(std::move(value));
+        }
+
+        m_cacheEnds.push_back(end);
+
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.cachesBuilt;
+        }
+    }
+
+    auto popCache() -> void
+    {
+        if constexpr(m_deltaCaches) {
+            m_bytes -= m_cache.bytes();
+            m_cache.pop_back();
+            m_bytes += m_cache.bytes();
+        }
+        else {
+            m_bytes -= sizeOf(m_cache.back());
+            m_cache.pop_back();
+        }
+
+        m_cacheEnds.pop_back();
+
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.cachesEvicted;
+        }
+    }
+
+    auto insertCache(std::size_t const index,
+                     T value,
+                     std::size_t const end) -> void
+    {
+        if constexpr(m_deltaCaches) {
+            m_bytes -= m_cache.bytes();
+            m_cache.insert(index, std::move(value));
+            m_bytes += m_cache.bytes();
+        }
+        else {
+            m_bytes += sizeOf(value);
+            m_cache.insert(m_cache.begin() + static_cast<std::ptrdiff_t>(index),
+                           std::move(value));
+        }
+
+        m_cacheEnds.insert(
+            m_cacheEnds.begin() + static_cast<std::ptrdiff_t>(index), end);
+
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.cachesBuilt;
+        }
+    }
+
+    auto eraseCache(std::size_t const index) -> void
+    {
+        if constexpr(m_deltaCaches) {
+            m_bytes -= m_cache.bytes();
+            m_cache.erase(index);
+            m_bytes += m_cache.bytes();
+        }
+        else {
+            m_bytes -= sizeOf(m_cache[index]);
+            m_cache.erase(m_cache.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+
+        m_cacheEnds.erase(m_cacheEnds.begin() +
+                          static_cast<std::ptrdiff_t>(index));
+
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.cachesEvicted;
+        }
+    }
+
+    ///
+    /// \returns The first cache, after removing it.
+    ///
+    [[nodiscard]] auto takeOldestCache() -> T
+    {
+        m_cacheEnds.pop_front();
+
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.cachesEvicted;
+        }
+
+        if constexpr(m_deltaCaches) {
+            // Copied since the next cache is rebuilt from it
+            T oldest{ m_cache.front() };
+
+            m_bytes -= m_cache.bytes();
+            m_cache.pop_front();
+            m_bytes += m_cache.bytes();
+
+            return oldest;
+        }
+        else {
+            m_bytes -= sizeOf(m_cache.front());
+            T oldest{ std::move(m_cache.front()) };
+            m_cache.pop_front();
+
+            return oldest;
+        }
+    }
+
+    auto clearUndo() -> void
+    {
+        if constexpr(m_undoTree) {
+            this->saveBranch(m_dataLimit);
+        }
+
+        while(m_data.size() > m_dataLimit) {
+            m_bytes -= sizeOf(m_data.back());
+            m_data.pop_back();
+        }
+
+        while(m_cache.size() > m_cacheLimit) {
+            this->popCache();
+        }
+
+        if(m_pending.value.valid() && m_pending.end > m_dataLimit) {
+            m_pending = PendingCache{};
+        }
+
+        m_lastBytes =
+            m_data.empty() ? 0 : sizeOf(std::as_const(m_data).back());
+        m_underUndo = false;
+    }
+
+    ///
+    /// Reduces `m_data[first, last)` on top of `value`. In adaptive mode this
+    /// is also where the cost of the reducing function gets measured.
+    ///
+    auto reduceRange(T& value, std::size_t first, std::size_t const last)
+        -> void
+    {
+        this->countCombines((last > first) ? last - first : 0);
+
+        if constexpr(!m_adaptive) {
+            for(; first < last; ++first) {
+                m_function(value, peek(m_data, first));
+            }
+        }
+        else {
+            auto const start = Clock::now();
+            std::size_t bytes{ 0 };
+
+            for(; first < last; ++first) {
+                auto& element = peek(m_data, first);
+                m_function(value, element);
+                bytes += sizeOf(element);
+            }
+
+            if(bytes == 0) {
+                return;
+            }
+
+            auto const elapsed =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - start);
+            auto const sample = static_cast<double>(elapsed.count()) /
+                                static_cast<double>(bytes);
+
+            m_nsPerByte = (m_nsPerByte == 0.0)
+                              ? sample
+                              : m_nsPerByte * 0.875 + sample * 0.125;
+        }
+    }
+
+    ///
+    /// \returns A new cache holding the reduction of `m_data[0, end)`. It
+    ///          starts from the cache at `previous`, if there is one.
+    ///
+    [[nodiscard]] auto makeCache(std::size_t const previous,
+                                 std::size_t const end) -> T
+    {
+        if(previous == 0) {
+            T result{ peek(m_data, 0) };
+            this->reduceRange(result, 1, end);
+            return result;
+        }
+
+        T result{ peek(m_cache, previous - 1) };
+        this->reduceRange(result, m_cacheEnds[previous - 1], end);
+        return result;
+    }
+
+    [[nodiscard]] auto estimatedCost(T const& value) const -> double
+    {
+        return m_nsPerByte * static_cast<double>(sizeOf(value));
+    }
+
+    [[nodiscard]] auto cacheCost(std::size_t const index) const -> double
+    {
+        if constexpr(m_deltaCaches) {
+            // Reducing always uses the whole cache, not its delta
+            return m_nsPerByte * static_cast<double>(m_cache.fullBytes(index));
+        }
+        else {
+            return this->estimatedCost(m_cache[index]);
+        }
+    }
+
+    ///
+    /// \returns The estimated time `reduceTo` needs when the last cache before
+    ///          `m_data[first, last)` is `previous`.
+    ///
+    [[nodiscard]] auto estimatedCost(std::size_t const previous,
+                                     std::size_t first,
+                                     std::size_t const last) const -> double
+    {
+        double cost = (previous == 0) ? 0.0 : this->cacheCost(previous - 1);
+
+        for(; first < last; ++first) {
+            cost += this->estimatedCost(m_data[first]);
+        }
+
+        return cost;
+    }
+
+    ///
+    /// \returns Where the cache after `m_data[0, start)` should end, looking
+    ///          at no more than the first `bound` elements. 0 means that the
+    ///          next cache isn't due yet.
+    ///
+    [[nodiscard]] auto nextCacheEnd(std::size_t const start,
+                                    std::size_t const bound) const
+        -> std::size_t
+    {
+        if constexpr(m_adaptive) {
+            if(m_nsPerByte > 0.0) {
+                double cost = m_cache.empty()
+                                  ? 0.0
+                                  : this->cacheCost(m_cache.size() - 1);
+
+                for(auto i = start; i < bound; ++i) {
+                    cost += this->estimatedCost(m_data[i]);
+
+                    if(cost > m_targetLatency) {
+                        return std::max(i, start + 1);
+                    }
+                    // Folding needs a cache before `Traits::maxCount` is hit
+                    if(i + 1 - start >= m_maxSpacing) {
+                        return i + 1;
+                    }
+                }
+
+                return 0;
+            }
+        }
+
+        return (start + m_cacheGap <= bound) ? start + m_cacheGap : 0;
+    }
+
+    ///
+    /// Builds caches for `m_data[0, bound)` until the next one isn't due yet.
+    /// Every new cache starts from the previous one so only the elements in
+    /// between get reduced.
+    ///
+    auto buildCaches(std::size_t const bound) -> void
+    {
+        for(;;) {
+            auto const start = m_cacheEnds.empty() ? 0 : m_cacheEnds.back();
+            auto const end = this->nextCacheEnd(start, bound);
+
+            if(end == 0) {
+                break;
+            }
+
+            this->pushCache(this->makeCache(m_cache.size(), end), end);
+            m_cacheLimit = m_cache.size();
+        }
+    }
+
+    ///
+    /// Hands the next cache that is due for `m_data[0, bound)` to the shared
+    /// thread pool. The job only sees copies so the history can keep changing
+    /// while it runs.
+    ///
+    auto scheduleCache(std::size_t const bound) -> void
+    {
+        if(m_pending.value.valid()) {
+            return;
+        }
+
+        auto const start = m_cacheEnds.empty() ? 0 : m_cacheEnds.back();
+        auto const end = this->nextCacheEnd(start, bound);
+
+        if(end == 0) {
+            return;
+        }
+
+        T base = m_cache.empty() ? T{ peek(m_data, 0) }
+                                 : T{ peek(m_cache, m_cache.size() - 1) };
+        std::vector<T> elements{};
+        elements.reserve(end - start);
+
+        for(auto i = m_cache.empty() ? 1 : start; i < end; ++i) {
+            elements.push_back(peek(m_data, i));
+        }
+
+        m_pending = PendingCache{
+            end,
+            sharedThreadPool()
+                .push([function = m_function,
+                       base = std::move(base),
+                       elements = std::move(elements)]() mutable -> T {
+                    for(auto& element : elements) {
+                        function(base, element);
+                    }
+
+                    return std::move(base);
+                })
+                .share()
+        };
+    }
+
+    ///
+    /// Publishes the cache built in the background if it's done, without
+    /// waiting for it.
+    ///
+    auto publishPending() -> void
+    {
+        if(!m_pending.value.valid() ||
+           m_pending.value.wait_for(std::chrono::seconds{ 0 }) !=
+               std::future_status::ready) {
+            return;
+        }
+
+        this->pushCache(m_pending.value.get(), m_pending.end);
+        m_pending = PendingCache{};
+
+        this->updateCacheLimit();
+    }
+
+    ///
+    /// Looks at one gap between caches per call and splits it if replaying
+    /// it got too slow or merges it with the next one if both together are
+    /// cheap enough. Doing a single step at a time keeps `emplaceBack` from
+    /// stalling whenever the measured cost changes.
+    ///
+    auto rebalanceStep() -> void
+    {
+        if(m_cache.empty() || m_nsPerByte <= 0.0) {
+            return;
+        }
+
+        auto const i = m_rebalanceCursor++ % m_cache.size();
+        auto const start = (i == 0) ? 0 : m_cacheEnds[i - 1];
+        auto const end = m_cacheEnds[i];
+
+        if(end - start > 1 &&
+           this->estimatedCost(i, start, end) > m_targetLatency) {
+            auto const middle = start + (end - start) / 2;
+            this->insertCache(i, this->makeCache(i, middle), middle);
+        }
+        // Merged gaps stay within the spacing `nextCacheEnd` allows, folding
+        // drops everything up to the first cache at once
+        else if(i + 1 < m_cache.size() &&
+                m_cacheEnds[i + 1] - start <= m_maxSpacing &&
+                this->estimatedCost(i, start, m_cacheEnds[i + 1]) <
+                    m_targetLatency / 2) {
+            this->eraseCache(i);
+        }
+
+        m_cacheLimit = m_cache.size();
+    }
+
+    ///
+    /// \returns true If a cache ending at `end` belongs to the hierarchy
+    ///          around the current position. A cache on a multiple of
+    ///          `cacheGap * 2^k` (and no higher power) is kept while it's less
+    ///          than `2 * cacheGap * 2^k` elements away.
+    ///
+    [[nodiscard]] auto isWanted(std::size_t const end) const noexcept -> bool
+    {
+        if(end == 0 || end % m_cacheGap != 0) {
+            return false;
+        }
+
+        auto const blocks = end / m_cacheGap;
+        auto const span = m_cacheGap * (blocks & ~(blocks - 1));
+        auto const distance =
+            (end > m_dataLimit) ? end - m_dataLimit : m_dataLimit - end;
+
+        return distance < 2 * span;
+    }
+
+    ///
+    /// Drops the caches that left the hierarchy and builds the ones at or
+    /// before the current position that are missing. There are at most four
+    /// per level so this stays logarithmic in the size of the history.
+    ///
+    auto refreshHierarchy() -> void
+    {
+        for(auto i = m_cache.size(); i > 0; --i) {
+            if(!this->isWanted(m_cacheEnds[i - 1])) {
+                this->eraseCache(i - 1);
+            }
+        }
+
+        // The newest element may still change so no cache can contain it
+        auto const bound =
+            std::min(m_dataLimit, m_data.empty() ? 0 : m_data.size() - 1);
+        std::deque<std::size_t> missing{};
+
+        for(auto span = m_cacheGap; span <= bound; span *= 2) {
+            auto end = (m_dataLimit > 2 * span)
+                           ? (m_dataLimit - 2 * span) / span * span
+                           : 0;
+
+            for(; end <= bound; end += span) {
+                if(end != 0 && (end / span) % 2 == 1 &&
+                   this->isWanted(end) &&
+                   !std::binary_search(
+                       m_cacheEnds.begin(), m_cacheEnds.end(), end)) {
+                    missing.push_back(end);
+                }
+            }
+        }
+
+        std::sort(missing.begin(), missing.end());
+
+        for(auto const end : missing) {
+            auto const previous = static_cast<std::size_t>(
+                std::distance(m_cacheEnds.begin(),
+                              std::upper_bound(
+                                  m_cacheEnds.begin(), m_cacheEnds.end(), end)));
+            this->insertCache(previous, this->makeCache(previous, end), end);
+        }
+
+        this->updateCacheLimit();
+    }
+
+    ///
+    /// Folds the elements covered by the first cache, together with the one
+    /// after them, into a single base element.
+    ///
+    /// The first cache already holds the reduction of the elements it covers
+    /// so only one call to `m_function` is needed. Every other cache still
+    /// describes the same prefix after the shift, only its end moves.
+    ///
+    auto foldOldest() -> void
+    {
+        auto const shift = m_cacheEnds.front();
+
+        auto base = this->takeOldestCache();
+        m_function(base, peek(m_data, shift));
+        this->countCombines(1);
+
+        for(std::size_t i = 0; i <= shift; ++i) {
+            m_bytes -= sizeOf(m_data.front());
+            m_data.pop_front();
+        }
+
+        m_bytes += sizeOf(base);
+        m_data.push_front(std::move(base));
+
+        for(auto& end : m_cacheEnds) {
+            end -= shift;
+        }
+        if(m_pending.value.valid()) {
+            m_pending.end -= shift;
+        }
+        if constexpr(m_undoTree) {
+            this->shiftBranches(m_branches, shift);
+        }
+
+        m_dataLimit = m_data.size();
+        m_cacheLimit = m_cache.size();
+        m_folded = true;
+    }
+
+    [[nodiscard]] static auto branchBytes(Branch const& branch) noexcept
+        -> std::size_t
+    {
+        auto bytes = branch.bytes;
+        for(auto const& child : branch.branches) {
+            bytes += branchBytes(child);
+        }
+
+        return bytes;
+    }
+
+    ///
+    /// Moves everything past `fork` into a new branch, together with the
+    /// branches hanging from that part of the line.
+    ///
+    auto saveBranch(std::size_t const fork) -> void
+    {
+        if(m_data.size() <= fork) {
+            return;
+        }
+
+        auto const allocator = this->get_allocator();
+        Branch branch{ fork,
+                       m_branchAge++,
+                       makeContainer<ContainerType>(allocator),
+                       makeContainer<ContainerType>(allocator),
+                       makeContainer<CacheEnds>(allocator) };
+
+        for(auto i = fork; i < m_data.size(); ++i) {
+            branch.bytes += sizeOf(m_data[i]);
+            branch.data.push_back(std::move(m_data[i]));
+        }
+        while(m_data.size() > fork) {
+            m_data.pop_back();
+        }
+
+        auto const firstCache = static_cast<std::size_t>(std::distance(
+            m_cacheEnds.begin(),
+            std::upper_bound(m_cacheEnds.begin(), m_cacheEnds.end(), fork)));
+
+        for(auto i = firstCache; i < m_cache.size(); ++i) {
+            branch.bytes += sizeOf(m_cache[i]);
+            branch.cache.push_back(std::move(m_cache[i]));
+            branch.cacheEnds.push_back(m_cacheEnds[i]);
+        }
+        while(m_cache.size() > firstCache) {
+            m_cache.pop_back();
+            m_cacheEnds.pop_back();
+        }
+
+        auto const nested = std::stable_partition(
+            m_branches.begin(), m_branches.end(), [fork](Branch const& b) {
+                return b.fork <= fork;
+            });
+        std::move(nested, m_branches.end(), std::back_inserter(branch.branches));
+        m_branches.erase(nested, m_branches.end());
+
+        m_branches.push_back(std::move(branch));
+    }
+
+    ///
+    /// Keeps the branches of `branches` that still have their fork after the
+    /// oldest `shift` elements were folded.
+    ///
+    auto shiftBranches(std::vector<Branch>& branches, std::size_t const shift)
+        -> void
+    {
+        auto const kept = std::stable_partition(
+            branches.begin(), branches.end(), [shift](Branch const& b) {
+                return b.fork > shift;
+            });
+
+        for(auto it = kept; it != branches.end(); ++it) {
+            m_bytes -= branchBytes(*it);
+        }
+        branches.erase(kept, branches.end());
+
+        for(auto& branch : branches) {
+            branch.fork -= shift;
+            for(auto& end : branch.cacheEnds) {
+                end -= shift;
+            }
+
+            this->shiftBranches(branch.branches, shift);
+        }
+    }
+
+    auto dropOldestBranch() -> void
+    {
+        auto const oldest = std::min_element(
+            m_branches.begin(),
+            m_branches.end(),
+            [](Branch const& a, Branch const& b) { return a.age < b.age; });
+
+        m_bytes -= branchBytes(*oldest);
+        m_branches.erase(oldest);
+    }
+
+    [[nodiscard]] auto overLimit() const noexcept -> bool
+    {
+        return m_data.size() > static_cast<std::size_t>(m_maxCount) ||
+               m_bytes > m_maxBytes;
+    }
+
+    ///
+    /// Lazy and background caches can still be missing when the limits are
+    /// hit, folding can't happen without the first one so it's built right
+    /// away, waiting for the background job if it's the one building it.
+    ///
+    /// \returns true If there is a cache to fold with.
+    ///
+    auto ensureFoldCache() -> bool
+    {
+        if constexpr(m_background) {
+            if(m_cache.empty() && m_pending.value.valid()) {
+                m_pending.value.wait();
+                this->publishPending();
+            }
+        }
+        if constexpr(m_lazy || m_background) {
+            if(m_cache.empty()) {
+                auto const end = this->nextCacheEnd(
+                    0, std::min(m_dataLimit, m_data.size() - 1));
+
+                if(end == 0) {
+                    return false;
+                }
+
+                this->pushCache(this->makeCache(0, end), end);
+                this->updateCacheLimit();
+            }
+        }
+
+        return !m_cache.empty() && m_data.size() > m_cacheEnds.front() + 1;
+    }
+
+    ///
+    /// Folds until both `Traits::maxCount` and `Traits::maxBytes` are
+    /// respected or there is nothing left to fold. The newest element is
+    /// never folded since `emplaceBack` returns a reference to it.
+    ///
+    auto enforceLimits() -> void
+    {
+        if constexpr(m_undoTree) {
+            while(m_bytes > m_maxBytes && !m_branches.empty()) {
+                this->dropOldestBranch();
+            }
+        }
+
+        if constexpr(m_invertible) {
+            while(this->overLimit() && m_data.size() > 2) {
+                this->foldInverse();
+            }
+        }
+        else {
+            while(this->overLimit() && this->ensureFoldCache()) {
+                this->foldOldest();
+            }
+        }
+    }
+
+    ///
+    /// What `emplaceBack` does around a new element, done once for all the
+    /// elements appended by `emplaceRange` so far.
+    ///
+    auto settleRange() -> void
+    {
+        auto const bound = m_data.size() - 1;
+
+        if constexpr(m_background) {
+            this->publishPending();
+            this->scheduleCache(bound);
+        }
+        else if constexpr(!m_hierarchical && !m_lazy && !m_invertible) {
+            this->buildCaches(bound);
+        }
+        if constexpr(m_adaptive && !m_lazy) {
+            this->rebalanceStep();
+        }
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
+        }
+
+        this->enforceLimits();
+    }
+
+    ///
+    /// Reduces `m_data[first, last)` in contiguous chunks, one of them on the
+    /// calling thread and the rest on `sharedThreadPool()`. The partial
+    /// results are merged pairwise, halving their number at every step.
+    ///
+    [[nodiscard]] auto reduceParallel(std::size_t const first,
+                                      std::size_t const last) -> T
+    {
+        auto& pool = sharedThreadPool();
+        auto const count = last - first;
+
+        if constexpr(m_spillable) {
+            // Bringing elements back in memory isn't thread safe
+            m_data.fetch(first, last);
+        }
+        auto const chunks = std::clamp<std::size_t>(
+            count / (m_parallelThreshold / 2), 1, pool.size() + 1);
+
+        auto const reduceChunk = [this, first, count, chunks](
+                                     std::size_t const chunk) -> T {
+            auto const begin = first + count * chunk / chunks;
+            auto const end = first + count * (chunk + 1) / chunks;
+
+            T partial{ peek(m_data, begin) };
+            for(auto i = begin + 1; i < end; ++i) {
+                m_function(partial, peek(m_data, i));
+            }
+
+            return partial;
+        };
+
+        std::vector<std::future<T>> pending{};
+        pending.reserve(chunks - 1);
+        for(std::size_t chunk = 1; chunk < chunks; ++chunk) {
+            pending.push_back(pool.push(reduceChunk, chunk));
+        }
 
-    bool m_underUndo{ false };
+        std::vector<T> partials{};
+        partials.reserve(chunks);
+        partials.push_back(reduceChunk(0));
 
-    using Function = void (*)(T&, T&);
-    Function m_function;
+        // Every task has to finish before anything can throw, they refer to
+        // this object
+        for(auto& future : pending) {
+            future.wait();
+        }
+        for(auto& future : pending) {
+            partials.push_back(future.get());
+        }
 
-    [[nodiscard]] auto getNumCaches() noexcept -> int
-    {
-        return m_cache.empty() ? 0
-                               : static_cast<int>(std::distance(m_cache.begin(),
-                                                                m_cacheLimit));
-    }
+        for(std::size_t stride = 1; stride < partials.size(); stride *= 2) {
+            std::vector<std::future<void>> merges{};
 
-    [[nodiscard]] inline auto noCaches() noexcept -> bool
-    {
-        return this->getNumCaches() <= 0;
-    }
+            for(auto i = 2 * stride; i + stride < partials.size();
+                i += 2 * stride) {
+                merges.push_back(pool.push([this, &partials, i, stride] {
+                    m_function(partials[i], partials[i + stride]);
+                }));
+            }
 
-    [[nodiscard]] auto getIteratorPastCache() noexcept -> Iterator
-    {
-        auto it = m_data.begin();
-        auto const offset = this->getNumCaches() * m_cacheGap;
-        auto const max =
-            static_cast<int>(std::distance(m_data.begin(), m_dataLimit));
+            m_function(partials[0], partials[stride]);
 
-        std::advance(it, std::min(max, offset));
+            for(auto& merge : merges) {
+                merge.wait();
+            }
+            for(auto& merge : merges) {
+                merge.get();
+            }
+        }
 
-        return it;
+        return std::move(partials.front());
     }
 
-    auto clearUndo() -> void
+    ///
+    /// \returns true If replaying from the last cache got long enough that
+    ///          the postponed caches should be built before reducing.
+    ///
+    [[nodiscard]] auto replayTooLong() const -> bool
     {
-        while(m_dataLimit != m_data.end()) {
-            m_data.pop_back();
-        }
+        auto const past = this->getIndexPastCache();
 
-        if(this->noCaches()) {
-            m_cache.clear();
-        }
-        else {
-            while(m_cacheLimit != m_cache.end()) {
-                m_cache.pop_back();
+        if constexpr(m_adaptive) {
+            if(m_nsPerByte > 0.0) {
+                return this->estimatedCost(m_cacheLimit, past, m_dataLimit) >
+                       2 * m_targetLatency;
             }
         }
 
-        m_underUndo = false;
+        return m_dataLimit - past > 2 * m_cacheGap;
     }
 
 public:
     CachedResource() = default;
     explicit CachedResource(Function f)
-        : m_function{ f }
+        : m_function{ std::move(f) }
+    {
+    }
+    ///
+    /// Elements, caches and cache ends are allocated with `allocator` when
+    /// `ContainerType` is allocator aware, see `sk::pmr::ResourceTraits`.
+    /// Copies use the default allocator, as with the standard containers.
+    ///
+    explicit CachedResource(allocator_type const& allocator)
+        : CachedResource{ Function{}, allocator }
+    {
+    }
+    CachedResource(Function f, allocator_type const& allocator)
+        : m_data{ makeContainer<ContainerType>(allocator) }
+        , m_cache{ makeContainer<CacheContainer>(allocator) }
+        , m_cacheEnds{ makeContainer<CacheEnds>(allocator) }
+        , m_function{ std::move(f) }
     {
     }
     CachedResource(CachedResource const&) = default;
@@ -101,91 +1759,328 @@ public:
     template<typename... Ts>
     auto emplaceBack(Ts&&... ts) -> T&
     {
+        auto const combines = this->getCombines();
+        this->refreshLastBytes();
+
+        if(m_underUndo) {
+            this->clearUndo();
+        }
+
+        if constexpr(m_background) {
+            this->publishPending();
+            this->scheduleCache(m_data.size());
+        }
+        else if constexpr(!m_hierarchical && !m_lazy && !m_invertible) {
+            this->buildCaches(m_data.size());
+        }
+        if constexpr(m_adaptive && !m_lazy) {
+            this->rebalanceStep();
+        }
+
+        m_data.emplace_back(std::forward<Ts>(ts)...);
+        m_dataLimit = m_data.size();
+        m_lastBytes = sizeOf(m_data.back());
+        m_bytes += m_lastBytes;
+
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
+        }
+
+        this->enforceLimits();
+        this->recordEmplaceCost(combines);
+        this->trimResident();
+
+        return m_data.back();
+    }
+
+    ///
+    /// Appends `[first, last)` as if `emplaceBack` was called for each
+    /// element, but the caches that land inside the range are built in a
+    /// single pass, each one from the previous, and the per call bookkeeping
+    /// only happens once. Limits are still enforced on the way, in every
+    /// mode, so a range bigger than `Traits::maxCount` doesn't have to fit
+    /// in memory. With lazy or background caches that means building the
+    /// first cache right away whenever there is none to fold with.
+    ///
+    /// Counts as a single call in `getEmplaceCosts`.
+    ///
+    template<typename InputIt>
+    auto emplaceRange(InputIt first, InputIt const last) -> void
+    {
+        if(first == last) {
+            return;
+        }
+
+        auto const combines = this->getCombines();
+        this->refreshLastBytes();
+
         if(m_underUndo) {
             this->clearUndo();
+        }
+
+        for(; first != last; ++first) {
+            m_data.emplace_back(*first);
+            m_dataLimit = m_data.size();
+            m_lastBytes = sizeOf(m_data.back());
+            m_bytes += m_lastBytes;
+
+            if(this->overLimit()) {
+                this->settleRange();
+            }
+        }
+
+        this->settleRange();
+        this->recordEmplaceCost(combines);
+        this->trimResident();
+    }
+
+    ///
+    /// Builds the caches postponed by `Traits::lazyCaches`, or publishes and
+    /// schedules the ones built by `Traits::backgroundCaches`. Meant to be
+    /// called when the application is idle. Does nothing in any other mode.
+    ///
+    auto materialize() -> void
+    {
+        if constexpr(m_background) {
+            this->publishPending();
+            this->scheduleCache(
+                std::min(m_dataLimit, m_data.empty() ? 0 : m_data.size() - 1));
+        }
+        else if constexpr(m_lazy) {
+            this->buildCaches(
+                std::min(m_dataLimit, m_data.empty() ? 0 : m_data.size() - 1));
+
+            if(!m_underUndo) {
+                if constexpr(m_adaptive) {
+                    this->rebalanceStep();
+                }
+
+                this->enforceLimits();
+            }
+
+            this->updateCacheLimit();
+        }
+
+        this->trimResident();
+    }
+
+    ///
+    /// Folds the oldest elements into one, like going over `Traits::maxCount`
+    /// or `Traits::maxBytes` does, for budgets kept outside of the resource.
+    /// Nothing is folded under undo, that would drop what can be redone.
+    ///
+    /// \returns true If something was folded.
+    ///          false If there was nothing left to fold.
+    ///
+    auto fold() -> bool
+    {
+        if(m_underUndo) {
+            return false;
+        }
+
+        if constexpr(m_invertible) {
+            if(m_data.size() <= 2) {
+                return false;
+            }
+
+            this->foldInverse();
+        }
+        else {
+            if(!this->ensureFoldCache()) {
+                return false;
+            }
+
+            this->foldOldest();
+        }
+
+        this->trimResident();
+        return true;
+    }
+
+    ///
+    /// Removes every element for which `pred` returns true, including the ones
+    /// that can only be reached through redo.
+    ///
+    /// Only the caches that cover a removed element are rebuilt, starting from
+    /// the last cache before the first removed element, so removing something
+    /// near the end costs about as much as the elements after it.
+    ///
+    /// \returns The number of removed elements.
+    ///
+    template<typename Predicate>
+    auto removeIf(Predicate pred) -> std::size_t
+    {
+        this->refreshLastBytes();
+
+        auto const first = std::find_if(m_data.cbegin(), m_data.cend(), pred);
+        if(first == m_data.cend()) {
+            return 0;
+        }
+
+        auto const index =
+            static_cast<std::size_t>(std::distance(m_data.cbegin(), first));
+        auto const oldLimit = m_dataLimit;
+
+        if constexpr(m_invertible) {
+            this->moveRunning(std::min(m_runningEnd, index));
+        }
+
+        // The first match is already known, `pred` sees every element once
+        m_bytes -= sizeOf(m_data[index]);
+        m_dataLimit -= (index < oldLimit) ? 1 : 0;
+        std::size_t removed{ 1 };
 
-            if(m_data.size() % m_cacheGap == 0) {
-                goto skip_cache;
+        auto kept = makeContainer<ContainerType>(this->get_allocator());
+        for(auto i = index + 1; i < m_data.size(); ++i) {
+            if(pred(m_data[i])) {
+                m_bytes -= sizeOf(m_data[i]);
+                ++removed;
+                m_dataLimit -= (i < oldLimit) ? 1 : 0;
             }
+            else {
+                kept.push_back(std::move(m_data[i]));
+            }
+        }
+
+        while(m_data.size() > index) {
+            m_data.pop_back();
+        }
+        for(auto& element : kept) {
+            m_data.push_back(std::move(element));
+        }
+
+        if(index == 0) {
+            m_folded = false;
+        }
+
+        if(m_pending.value.valid() && m_pending.end > index) {
+            m_pending = PendingCache{};
         }
 
-        if(m_data.size() == m_cacheGap) {
-            m_cache.emplace_back(*(m_data.begin()));
+        if constexpr(m_undoTree) {
+            // Their shared part changed, so their caches are no longer valid
+            auto const stale = std::stable_partition(
+                m_branches.begin(), m_branches.end(), [index](Branch const& b) {
+                    return b.fork <= index;
+                });
 
-            for(auto it = m_data.begin() + 1; it != m_data.end(); ++it) {
-                m_function(m_cache.back(), *it);
+            for(auto it = stale; it != m_branches.end(); ++it) {
+                m_bytes -= branchBytes(*it);
             }
+            m_branches.erase(stale, m_branches.end());
+        }
+
+        while(!m_cacheEnds.empty() && m_cacheEnds.back() > index) {
+            this->popCache();
+        }
 
-            m_cacheLimit = m_cache.end();
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
         }
-        else if(!m_data.empty() && m_data.size() % m_cacheGap == 0) {
-            auto const begin = this->getIteratorPastCache();
-            m_cache.emplace_back(m_cache.back());
+        else {
+            m_cacheLimit = m_cache.size();
 
-            for(auto it = begin; it != m_data.end(); ++it) {
-                m_function(m_cache.back(), *it);
+            if constexpr(!m_lazy && !m_background && !m_invertible) {
+                this->buildCaches(m_data.empty() ? 0 : m_data.size() - 1);
             }
 
-            m_cacheLimit = m_cache.end();
+            this->updateCacheLimit();
         }
 
-    skip_cache:
-        m_data.emplace_back(std::forward<Ts>(ts)...);
-        m_dataLimit = m_data.end();
-        return m_data.back();
+        m_lastBytes =
+            m_data.empty() ? 0 : sizeOf(std::as_const(m_data).back());
+        m_underUndo = m_underUndo && m_dataLimit < m_data.size();
+
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+
+        this->trimResident();
+
+        return removed;
     }
 
     [[nodiscard]] auto getLastCache() noexcept -> T*
     {
+        if constexpr(m_invertible) {
+            return m_running.has_value() ? &*m_running : nullptr;
+        }
+
         if(this->noCaches()) {
             return nullptr;
         }
 
-        return &(*(m_cacheLimit - 1));
+        return &peek(m_cache, m_cacheLimit - 1);
     }
 
     auto reduceTo(T& value) -> void
     {
-        if(this->noCaches()) {
-            for(auto it = m_data.begin(); it != m_dataLimit; ++it) {
-                m_function(value, *it);
+        if constexpr(m_lazy) {
+            if(this->replayTooLong()) {
+                this->materialize();
             }
-            return;
+        }
+        if constexpr(m_background) {
+            this->materialize();
         }
 
-        m_function(value, *(this->getLastCache()));
-        auto begin = this->getIteratorPastCache();
+        auto* const cache = this->getLastCache();
+        if(cache != nullptr) {
+            m_function(value, *cache);
+        }
+
+        auto const first = this->getIndexPastCache();
+        this->countReduce(cache != nullptr, first);
+
+        if constexpr(m_associative) {
+            if(m_dataLimit - first >= m_parallelThreshold) {
+                T rest = this->reduceParallel(first, m_dataLimit);
+                m_function(value, rest);
+                return;
+            }
+        }
 
-        for(auto it = begin; it != m_dataLimit; ++it) {
-            m_function(value, *it);
+        for(auto i = first; i < m_dataLimit; ++i) {
+            m_function(value, peek(m_data, i));
         }
     }
 
     template<typename F2>
     auto reduceTo(F2 f) -> void
     {
-        if(this->noCaches()) {
-            for(auto it = m_data.begin(); it != m_dataLimit; ++it) {
-                f(*it);
+        if constexpr(m_lazy) {
+            if(this->replayTooLong()) {
+                this->materialize();
             }
-            return;
+        }
+        if constexpr(m_background) {
+            this->materialize();
         }
 
-        f(*(this->getLastCache()));
-        auto begin = this->getIteratorPastCache();
+        auto* const cache = this->getLastCache();
+        if(cache != nullptr) {
+            f(*cache);
+        }
+
+        auto const first = this->getIndexPastCache();
+        this->countReduce(cache != nullptr, first);
 
-        for(auto it = begin; it != m_dataLimit; ++it) {
-            f(*it);
+        for(auto i = first; i < m_dataLimit; ++i) {
+            f(peek(m_data, i));
         }
     }
 
     [[nodiscard]] auto getLast() noexcept -> T&
     {
-        return *(m_dataLimit - 1);
+        return m_data[m_dataLimit - 1];
     }
     [[nodiscard]] auto getLast() const noexcept -> T const&
     {
-        return *(m_dataLimit - 1);
+        return m_data[m_dataLimit - 1];
     }
 
     [[nodiscard]] constexpr auto underUndo() const noexcept -> bool
@@ -193,6 +2088,97 @@ public:
         return m_underUndo;
     }
 
+    ///
+    /// \returns true If the oldest elements were folded into a base element
+    ///          because `Traits::maxCount` was exceeded.
+    ///
+    [[nodiscard]] constexpr auto folded() const noexcept -> bool
+    {
+        return m_folded;
+    }
+
+    ///
+    /// \returns The number of bytes held by all elements and caches, as
+    ///          reported by `Traits::sizeOf`. Changes made to the newest
+    ///          element are picked up on the next `emplaceBack`.
+    ///
+    [[nodiscard]] constexpr auto getBytes() const noexcept -> std::size_t
+    {
+        return m_bytes;
+    }
+
+    ///
+    /// \returns Where each cache ends, `m_data[0, end)` is what it holds.
+    ///
+    [[nodiscard]] auto getCacheEnds() const noexcept -> CacheEnds const&
+    {
+        return m_cacheEnds;
+    }
+
+    ///
+    /// \returns The measured cost of the reducing function in nanoseconds
+    ///          per byte of `Traits::sizeOf`. Always 0 outside adaptive mode.
+    ///
+    [[nodiscard]] constexpr auto getNsPerByte() const noexcept -> double
+    {
+        return m_nsPerByte;
+    }
+
+    ///
+    /// \returns How many calls to the reducing function each `emplaceBack`
+    ///          needed. Bucket 0 counts the calls that needed none, bucket
+    ///          `i` the ones that needed between `2^(i - 1)` and `2^i - 1`.
+    ///          Needs `Traits::targetLatency`, `Traits::lazyCaches` or
+    ///          `Traits::statistics`.
+    ///
+    [[nodiscard]] constexpr auto getEmplaceCosts() const noexcept
+        -> std::array<std::size_t, m_costBuckets> const&
+    {
+        static_assert(m_keepCosts,
+                      "Emplace costs need adaptive or lazy caches, or "
+                      "statistics!");
+
+        return this->m_emplaceCosts;
+    }
+
+    ///
+    /// \returns The counters kept since construction or the last
+    ///          `resetStatistics`, together with the current sizes. Needs
+    ///          `Traits::statistics`. Summing the cache bytes walks every
+    ///          cache.
+    ///
+    [[nodiscard]] auto getStatistics() const -> CacheStatistics
+    {
+        static_assert(m_collectStatistics,
+                      "Statistics have to be enabled through the traits!");
+
+        auto statistics = this->m_statistics;
+        statistics.undoDepth = m_data.size() - m_dataLimit;
+        statistics.elements = m_data.size();
+        statistics.caches = m_cache.size();
+        statistics.bytes = m_bytes;
+
+        if constexpr(m_deltaCaches) {
+            statistics.cacheBytes = m_cache.bytes();
+        }
+        else {
+            statistics.cacheBytes = m_runningBytes;
+            for(std::size_t i = 0; i < m_cache.size(); ++i) {
+                statistics.cacheBytes += sizeOf(m_cache[i]);
+            }
+        }
+
+        return statistics;
+    }
+
+    auto resetStatistics() noexcept -> void
+    {
+        static_assert(m_collectStatistics,
+                      "Statistics have to be enabled through the traits!");
+
+        this->m_statistics = CacheStatistics{};
+    }
+
     ///
     /// \returns true If undo was successful.
     ///          false If already at oldest change.
@@ -201,47 +2187,201 @@ public:
     {
         m_underUndo = true;
 
-        auto const distance = std::distance(m_data.begin(), m_dataLimit);
-        if(distance == 0) {
+        // The base element holds everything that was folded so it can't be
+        // undone on its own
+        if(m_dataLimit == 0 || (m_folded && m_dataLimit == 1)) {
             return false;
         }
 
         --m_dataLimit;
 
-        bool const onCache = ((distance % m_cacheGap) == 0);
-        if(!this->noCaches() && onCache) {
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.undos;
+            this->recordUndoDepth();
+        }
+
+        if(!this->noCaches() && m_cacheEnds[m_cacheLimit - 1] > m_dataLimit) {
             --m_cacheLimit;
         }
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
+        }
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+
+        this->trimResident();
+
+        return true;
+    }
+
+    ///
+    /// Moves to the version where the first `index` elements are visible,
+    /// same as calling undo/redo until getting there. Finding the last cache
+    /// is a binary search over the cache ends, so the next `reduceTo` is the
+    /// only thing that touches the elements.
+    ///
+    /// \returns false If `index` is past the newest element or would undo
+    ///          the folded base element, nothing changes in that case.
+    ///
+    auto seek(std::size_t const index) -> bool
+    {
+        if(index > m_data.size() || (m_folded && index == 0)) {
+            return false;
+        }
+
+        m_dataLimit = index;
+        m_underUndo = m_dataLimit < m_data.size();
+        this->updateCacheLimit();
+
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.seeks;
+            this->recordUndoDepth();
+        }
+
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
+        }
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+
+        this->trimResident();
 
         return true;
     }
 
+    ///
+    /// \returns The number of visible elements, what `seek` moves.
+    ///
+    [[nodiscard]] constexpr auto getPosition() const noexcept -> std::size_t
+    {
+        return m_dataLimit;
+    }
+
     ///
     /// \returns true If redo can be done still.
     ///          false If got to the newest change.
     ///
     [[nodiscard]] auto redo() -> bool
     {
-        if(!m_underUndo) {
+        if(!m_underUndo || m_dataLimit == m_data.size()) {
             return false;
         }
         bool val = true;
-        if(m_dataLimit + 1 == m_data.end()) {
+        if(m_dataLimit + 1 == m_data.size()) {
             m_underUndo = false;
             val = false;
         }
 
         ++m_dataLimit;
 
-        auto const distance = std::distance(m_data.begin(), m_dataLimit);
+        if constexpr(m_collectStatistics) {
+            ++this->m_statistics.redos;
+        }
 
-        if(!m_cache.empty() && distance % m_cacheGap == 0) {
+        if(m_cacheLimit < m_cache.size() &&
+           m_cacheEnds[m_cacheLimit] <= m_dataLimit) {
             ++m_cacheLimit;
         }
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
+        }
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+
+        this->trimResident();
 
         return val;
     }
 
+    ///
+    /// \returns The number of branches hanging from the current line. Always
+    ///          0 without `Traits::undoTree`.
+    ///
+    [[nodiscard]] auto getBranchCount() const noexcept -> std::size_t
+    {
+        return m_branches.size();
+    }
+
+    ///
+    /// \returns How many elements the branch at `index` shares with the
+    ///          current line.
+    ///
+    [[nodiscard]] auto getBranchFork(std::size_t const index) const noexcept
+        -> std::size_t
+    {
+        return m_branches[index].fork;
+    }
+
+    ///
+    /// Makes the branch at `index` the current line and moves to its newest
+    /// element. Everything past the fork becomes a branch, so switching back
+    /// and forth never loses anything. The caches of the branch are kept, so
+    /// the next `reduceTo` costs at most one cache and a gap of elements.
+    ///
+    /// \returns false If there is no branch at `index`.
+    ///
+    auto switchBranch(std::size_t const index) -> bool
+    {
+        if(index >= m_branches.size()) {
+            return false;
+        }
+
+        this->refreshLastBytes();
+
+        auto branch = std::move(m_branches[index]);
+        m_branches.erase(m_branches.begin() +
+                         static_cast<std::ptrdiff_t>(index));
+
+        if(m_pending.value.valid() && m_pending.end > branch.fork) {
+            m_pending = PendingCache{};
+        }
+        if constexpr(m_invertible) {
+            this->moveRunning(std::min(m_runningEnd, branch.fork));
+        }
+
+        this->saveBranch(branch.fork);
+
+        for(auto& element : branch.data) {
+            m_data.push_back(std::move(element));
+        }
+        for(std::size_t i = 0; i < branch.cache.size(); ++i) {
+            m_cache.push_back(std::move(branch.cache[i]));
+            m_cacheEnds.push_back(branch.cacheEnds[i]);
+        }
+        for(auto& child : branch.branches) {
+            m_branches.push_back(std::move(child));
+        }
+
+        m_dataLimit = m_data.size();
+        m_cacheLimit = m_cache.size();
+        m_lastBytes = sizeOf(m_data.back());
+        m_underUndo = false;
+
+        if constexpr(m_hierarchical) {
+            this->refreshHierarchy();
+        }
+        if constexpr(m_invertible) {
+            this->syncRunning();
+        }
+
+        this->trimResident();
+
+        return true;
+    }
+
+    [[nodiscard]] auto get_allocator() const noexcept -> allocator_type
+    {
+        if constexpr(impl::AllocatorOf<ContainerType, T>::aware) {
+            return m_data.get_allocator();
+        }
+        else {
+            return allocator_type{};
+        }
+    }
+
     [[nodiscard]] auto getUnderlying() noexcept -> ContainerType&
     {
         return m_data;
@@ -252,6 +2392,16 @@ public:
     }
 };
 
+template<typename T>
+CachedResource(void (*)(T&, T&))
+    -> CachedResource<T, ResourceTraits<T>, void (*)(T&, T&)>;
+
+template<typename F>
+CachedResource(F)
+    -> CachedResource<typename impl::ReducedType<F>::type,
+                      ResourceTraits<typename impl::ReducedType<F>::type>,
+                      F>;
+
 } // namespace sk
 
 #endif // !CACHED_SEQ_HPP
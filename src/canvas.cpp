@@ -1,4 +1,5 @@
 #include "canvas.hpp"
+#include "canvas_config.hpp"
 
 #include <cstddef>
 #include <iostream>
@@ -9,11 +10,18 @@ Canvas::Canvas(QQuickPaintedItem* parent)
     : QQuickPaintedItem{ parent }
 {
     // m_points.emplace_back();
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(sk::config::idleDelay);
+
+    QObject::connect(&m_idleTimer, &QTimer::timeout, this, [this]() -> void {
+        m_history.materialize();
+    });
 }
 
 auto Canvas::mousePositionChanged(QPoint const& pos) -> void
 {
     // m_points.back().emplace_back(pos.x(), pos.y());
+    m_idleTimer.stop();
     m_history.drawAt(pos, m_pen);
     this->update();
 }
@@ -37,6 +45,7 @@ auto Canvas::mouseReleased() -> void
 {
     // m_points.emplace_back();
     m_history.pushNewLayer();
+    m_idleTimer.start();
 }
 
 auto Canvas::undo() -> void
@@ -7,6 +7,7 @@
 #include <QPainter>
 #include <QPoint>
 #include <QQuickPaintedItem>
+#include <QTimer>
 
 #include <vector>
 
@@ -18,6 +19,7 @@ private:
     Q_OBJECT
 
     DrawHistory m_history{};
+    QTimer m_idleTimer{};
     QPen m_pen{
         QColor{ "black" }, 10.0, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin
     };
@@ -6,6 +6,10 @@ namespace sk::config {
 
 inline constexpr int width = 400;
 inline constexpr int height = 600;
+// Milliseconds without input after which postponed work is done
+inline constexpr int idleDelay = 250;
+// Side of the square tiles layers are stored in
+inline constexpr int tileSize = 64;
 
 } // namespace sk::config
 
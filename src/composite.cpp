@@ -0,0 +1,235 @@
+#include "composite.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SK_COMPOSITE_SSE2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SK_TARGET_AVX2
+#endif
+
+namespace {
+
+///
+/// `x * a / 255` for `x` and `a` up to 255, rounded the way `QPainter`
+/// does it so layers look the same whichever draws them.
+///
+[[nodiscard]] constexpr auto multiply(std::uint32_t const x,
+                                      std::uint32_t const a) noexcept
+    -> std::uint32_t
+{
+    auto const t = x * a;
+    return (t + (t >> 8) + 0x80) >> 8;
+}
+
+[[nodiscard]] constexpr auto blend(std::uint32_t const dest,
+                                   std::uint32_t const src) noexcept
+    -> std::uint32_t
+{
+    auto const inverse = 255 - (src >> 24);
+    std::uint32_t result{ 0 };
+
+    for(std::uint32_t shift = 0; shift < 32; shift += 8) {
+        auto const channel = ((src >> shift) & 0xFF) +
+                             multiply((dest >> shift) & 0xFF, inverse);
+        result |= (channel > 0xFF ? 0xFF : channel) << shift;
+    }
+
+    return result;
+}
+
+#ifdef SK_COMPOSITE_SSE2
+
+///
+/// Multiplies the 16 bit channels of two pixels in `dest` by the inverse
+/// alpha of the matching pixel in `src`, rounded like `multiply`.
+///
+[[nodiscard]] inline auto multiplySse2(__m128i const dest,
+                                       __m128i const src) noexcept -> __m128i
+{
+    // Spreads each pixel's alpha over its 4 channels
+    auto alpha = _mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+    auto const inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    auto const t = _mm_mullo_epi16(dest, inverse);
+    return _mm_srli_epi16(
+        _mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)),
+                      _mm_set1_epi16(0x80)),
+        8);
+}
+
+[[nodiscard]] inline auto blendSse2(__m128i const dest,
+                                    __m128i const src) noexcept -> __m128i
+{
+    auto const zero = _mm_setzero_si128();
+    auto const low = multiplySse2(_mm_unpacklo_epi8(dest, zero),
+                                  _mm_unpacklo_epi8(src, zero));
+    auto const high = multiplySse2(_mm_unpackhi_epi8(dest, zero),
+                                   _mm_unpackhi_epi8(src, zero));
+
+    return _mm_adds_epu8(src, _mm_packus_epi16(low, high));
+}
+
+auto sourceOverSse2(std::uint32_t* const dest,
+                    std::uint32_t const* const src,
+                    std::size_t const count) noexcept -> void
+{
+    std::size_t i{ 0 };
+
+    for(; i + 4 <= count; i += 4) {
+        auto const s =
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        auto const d = _mm_loadu_si128(reinterpret_cast<__m128i*>(dest + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                         blendSse2(d, s));
+    }
+
+    sk::impl::sourceOverScalar(dest + i, src + i, count - i);
+}
+
+///
+/// Same as `multiplySse2` for 4 pixels. The unpacking, shuffles and packing
+/// all work within 128 bit lanes so the pixels stay in order.
+///
+SK_TARGET_AVX2 inline auto multiplyAvx2(__m256i const dest,
+                                        __m256i const src) noexcept
+    -> __m256i
+{
+    auto alpha = _mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+    auto const inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+    auto const t = _mm256_mullo_epi16(dest, inverse);
+    return _mm256_srli_epi16(
+        _mm256_add_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)),
+                         _mm256_set1_epi16(0x80)),
+        8);
+}
+
+SK_TARGET_AVX2 inline auto blendAvx2(__m256i const dest,
+                                     __m256i const src) noexcept -> __m256i
+{
+    auto const zero = _mm256_setzero_si256();
+    auto const low = multiplyAvx2(_mm256_unpacklo_epi8(dest, zero),
+                                  _mm256_unpacklo_epi8(src, zero));
+    auto const high = multiplyAvx2(_mm256_unpackhi_epi8(dest, zero),
+                                   _mm256_unpackhi_epi8(src, zero));
+
+    return _mm256_adds_epu8(src, _mm256_packus_epi16(low, high));
+}
+
+SK_TARGET_AVX2 auto sourceOverAvx2(std::uint32_t* const dest,
+                                   std::uint32_t const* const src,
+                                   std::size_t const count) noexcept -> void
+{
+    std::size_t i{ 0 };
+
+    for(; i + 8 <= count; i += 8) {
+        auto const s =
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        auto const d =
+            _mm256_loadu_si256(reinterpret_cast<__m256i*>(dest + i));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                            blendAvx2(d, s));
+    }
+
+    sourceOverSse2(dest + i, src + i, count - i);
+}
+
+[[nodiscard]] auto hasAvx2() noexcept -> bool
+{
+#ifdef _MSC_VER
+    int info[4]{};
+    __cpuid(info, 0);
+    if(info[0] < 7) {
+        return false;
+    }
+
+    // The OS has to save the AVX registers too
+    __cpuid(info, 1);
+    auto const osxsave = (info[2] & (1 << 27)) != 0;
+    if(!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+using Kernel = void (*)(std::uint32_t*, std::uint32_t const*, std::size_t);
+
+struct Dispatch
+{
+    Kernel kernel{ &sk::impl::sourceOverScalar };
+    char const* name{ "scalar" };
+};
+
+[[nodiscard]] auto getDispatch() noexcept -> Dispatch const&
+{
+    static Dispatch const dispatch = []() -> Dispatch {
+#ifdef SK_COMPOSITE_SSE2
+        if(hasAvx2()) {
+            return { &sourceOverAvx2, "avx2" };
+        }
+
+        return { &sourceOverSse2, "sse2" };
+#else
+        return {};
+#endif
+    }();
+
+    return dispatch;
+}
+
+} // namespace
+
+namespace sk {
+
+namespace impl {
+
+auto sourceOverScalar(std::uint32_t* const dest,
+                      std::uint32_t const* const src,
+                      std::size_t const count) noexcept -> void
+{
+    for(std::size_t i = 0; i < count; ++i) {
+        auto const alpha = src[i] >> 24;
+
+        if(alpha == 0xFF) {
+            dest[i] = src[i];
+        }
+        else if(src[i] != 0) {
+            dest[i] = blend(dest[i], src[i]);
+        }
+    }
+}
+
+} // namespace impl
+
+auto sourceOver(std::uint32_t* const dest,
+                std::uint32_t const* const src,
+                std::size_t const count) noexcept -> void
+{
+    getDispatch().kernel(dest, src, count);
+}
+
+[[nodiscard]] auto sourceOverKernel() noexcept -> char const*
+{
+    return getDispatch().name;
+}
+
+} // namespace sk
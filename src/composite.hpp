@@ -0,0 +1,39 @@
+#ifndef COMPOSITE_HPP
+#define COMPOSITE_HPP
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sk {
+
+///
+/// Draws `count` premultiplied ARGB32 pixels from `src` over the ones in
+/// `dest`, which is what `QPainter` does by default for
+/// `QImage::Format_ARGB32_Premultiplied`:
+///
+///     dest = src + dest * (255 - alpha(src)) / 255
+///
+/// for every channel. Uses AVX2 when the CPU has it, SSE2 on any other x86
+/// CPU and plain C++ elsewhere, they all give the same result.
+///
+auto sourceOver(std::uint32_t* dest,
+                std::uint32_t const* src,
+                std::size_t count) noexcept -> void;
+
+///
+/// \returns The name of the implementation `sourceOver` uses.
+///
+[[nodiscard]] auto sourceOverKernel() noexcept -> char const*;
+
+namespace impl {
+
+auto sourceOverScalar(std::uint32_t* dest,
+                      std::uint32_t const* src,
+                      std::size_t count) noexcept -> void;
+
+} // namespace impl
+
+} // namespace sk
+
+#endif // !COMPOSITE_HPP
@@ -0,0 +1,322 @@
+#ifndef CONCURRENT_CACHED_RESOURCE_HPP
+#define CONCURRENT_CACHED_RESOURCE_HPP
+#pragma once
+
+#include "cached_resource.hpp"
+#include "epoch.hpp"
+#include "ring_buffer.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace sk {
+
+///
+/// Version of `CachedResource` where a single writer thread calls
+/// `emplaceBack`, `undo` and `redo` while any number of reader threads call
+/// `reduceTo`, each reader reducing a consistent version.
+///
+/// Elements are immutable once published. Each one points to the one before
+/// it, and every `Traits::cacheGap`th holds the reduction of everything up
+/// to it. A version is just a pointer to its newest element, which the
+/// writer swaps atomically, so `reduceTo` walks back at most
+/// `Traits::cacheGap` elements without taking a lock. Elements the writer
+/// drops are freed once no reader can reach them, see `EpochDomain`.
+///
+/// Only `cacheGap` and `maxCount` are used from `Traits`, past `maxCount`
+/// the oldest elements are dropped a cache gap at a time. The reducing
+/// function is called from several threads at once and must not modify its
+/// second argument, which can be shared by them.
+///
+template<typename T,
+         typename Traits = ResourceTraits<T>,
+         typename Function = void (*)(T&, T&)>
+class ConcurrentCachedResource
+{
+private:
+    static constexpr auto m_cacheGap = static_cast<std::size_t>(Traits::cacheGap);
+    static constexpr auto m_maxCount = static_cast<std::size_t>(Traits::maxCount);
+
+    static_assert(Traits::cacheGap > 0,
+                  "The cache gap should be bigger than 0!");
+    static_assert(m_maxCount > m_cacheGap,
+                  "The cache limit should be bigger than the cache gap!");
+
+    struct Node
+    {
+        T value;
+        // Reduction of every element up to and including `value`
+        std::optional<T> cache{};
+        // Never followed past a node with a cache
+        Node const* previous{ nullptr };
+        // Elements without a cache from this one back to the last cache
+        std::size_t sinceCache{ 0 };
+    };
+
+    struct Retired
+    {
+        Node* node{ nullptr };
+        std::uint64_t epoch{ 0 };
+    };
+
+    // Owned by the writer: the whole line including what can be redone
+    RingBuffer<Node*> m_line{};
+    std::size_t m_limit{ 0 };
+    bool m_folded{ false };
+
+    RingBuffer<Retired> m_retired{};
+
+    // Shared with the readers
+    std::atomic<Node const*> m_top{ nullptr };
+    EpochDomain m_epochs{};
+
+    Function m_function{};
+
+    auto publish() noexcept -> void
+    {
+        m_top.store(m_limit == 0 ? nullptr : m_line[m_limit - 1]);
+    }
+
+    ///
+    /// Frees `node` once every reader that might see it is gone. It must
+    /// already be unreachable from what's published.
+    ///
+    auto retire(Node* const node) -> void
+    {
+        m_retired.push_back(Retired{ node, m_epochs.advance() });
+    }
+
+    auto collect() noexcept -> void
+    {
+        auto const oldest = m_epochs.oldestPinned();
+
+        while(!m_retired.empty() && m_retired.front().epoch < oldest) {
+            delete m_retired.front().node;
+            m_retired.pop_front();
+        }
+    }
+
+    ///
+    /// Gives `node` its cache, called before it's published.
+    ///
+    auto makeCache(Node& node) -> void
+    {
+        std::array<Node const*, m_cacheGap> pending{};
+        std::size_t count{ 0 };
+
+        auto const* it = node.previous;
+        for(; it != nullptr && !it->cache.has_value(); it = it->previous) {
+            pending[count++] = it;
+        }
+
+        std::optional<T> cache{};
+        if(it != nullptr) {
+            cache.emplace(*it->cache);
+        }
+
+        for(auto i = count; i-- > 0;) {
+            auto& src = const_cast<T&>(pending[i]->value);
+
+            if(cache.has_value()) {
+                m_function(*cache, src);
+            }
+            else {
+                cache.emplace(src);
+            }
+        }
+
+        if(cache.has_value()) {
+            m_function(*cache, node.value);
+        }
+        else {
+            cache.emplace(node.value);
+        }
+
+        node.cache = std::move(cache);
+        node.sinceCache = 0;
+    }
+
+    ///
+    /// Drops the elements before the second cache, the first one becomes
+    /// the base holding all of them.
+    ///
+    auto dropOldest() -> void
+    {
+        std::size_t end{ 1 };
+        while(end < m_line.size() && !m_line[end]->cache.has_value()) {
+            ++end;
+        }
+
+        if(end == m_line.size() || end >= m_limit) {
+            return;
+        }
+
+        for(std::size_t i = 0; i < end; ++i) {
+            this->retire(m_line.front());
+            m_line.pop_front();
+        }
+
+        m_limit -= end;
+        m_folded = true;
+    }
+
+public:
+    ConcurrentCachedResource() = default;
+    explicit ConcurrentCachedResource(Function f)
+        : m_function{ std::move(f) }
+    {
+    }
+    ConcurrentCachedResource(ConcurrentCachedResource const&) = delete;
+    ConcurrentCachedResource(ConcurrentCachedResource&&) = delete;
+    ///
+    /// No reader may be using it anymore.
+    ///
+    ~ConcurrentCachedResource() noexcept
+    {
+        for(auto* const node : m_line) {
+            delete node;
+        }
+        for(auto const& retired : m_retired) {
+            delete retired.node;
+        }
+    }
+
+    auto operator=(ConcurrentCachedResource const&)
+        -> ConcurrentCachedResource& = delete;
+    auto operator=(ConcurrentCachedResource &&)
+        -> ConcurrentCachedResource& = delete;
+
+    ///
+    /// Writer only. Publishes a version with the new element as the newest,
+    /// anything that could be redone is dropped.
+    ///
+    template<typename... Ts>
+    auto emplaceBack(Ts&&... ts) -> void
+    {
+        while(m_line.size() > m_limit) {
+            this->retire(m_line.back());
+            m_line.pop_back();
+        }
+
+        auto* const node = new Node{ T(std::forward<Ts>(ts)...) };
+        node->previous = m_limit == 0 ? nullptr : m_line[m_limit - 1];
+        node->sinceCache =
+            node->previous == nullptr ? 1 : node->previous->sinceCache + 1;
+
+        try {
+            if(node->sinceCache == m_cacheGap) {
+                this->makeCache(*node);
+            }
+
+            m_line.push_back(node);
+        }
+        catch(...) {
+            delete node;
+            throw;
+        }
+
+        m_limit = m_line.size();
+        this->publish();
+
+        if(m_line.size() > m_maxCount) {
+            this->dropOldest();
+        }
+
+        this->collect();
+    }
+
+    ///
+    /// Writer only.
+    ///
+    /// \returns true If undo was successful.
+    ///          false If already at oldest change.
+    ///
+    [[nodiscard]] auto undo() -> bool
+    {
+        if(m_limit == 0 || (m_folded && m_limit == 1)) {
+            return false;
+        }
+
+        --m_limit;
+        this->publish();
+        this->collect();
+
+        return true;
+    }
+
+    ///
+    /// Writer only.
+    ///
+    /// \returns true If redo can be done still.
+    ///          false If got to the newest change.
+    ///
+    [[nodiscard]] auto redo() -> bool
+    {
+        if(m_limit == m_line.size()) {
+            return false;
+        }
+
+        ++m_limit;
+        this->publish();
+        this->collect();
+
+        return m_limit < m_line.size();
+    }
+
+    [[nodiscard]] auto underUndo() const noexcept -> bool
+    {
+        return m_limit < m_line.size();
+    }
+    [[nodiscard]] auto folded() const noexcept -> bool
+    {
+        return m_folded;
+    }
+    ///
+    /// \returns The number of visible elements, writer only.
+    ///
+    [[nodiscard]] auto getPosition() const noexcept -> std::size_t
+    {
+        return m_limit;
+    }
+
+    ///
+    /// Can be called from any thread, concurrently with the writer. Reduces
+    /// the version that was published when it started.
+    ///
+    auto reduceTo(T& value) -> void
+    {
+        auto const guard = m_epochs.pin();
+
+        std::array<Node const*, m_cacheGap> pending{};
+        std::size_t count{ 0 };
+
+        auto const* it = m_top.load();
+        for(; it != nullptr && !it->cache.has_value(); it = it->previous) {
+            pending[count++] = it;
+        }
+
+        if(it != nullptr) {
+            m_function(value, const_cast<T&>(*it->cache));
+        }
+        for(auto i = count; i-- > 0;) {
+            m_function(value, const_cast<T&>(pending[i]->value));
+        }
+    }
+};
+
+template<typename T>
+ConcurrentCachedResource(void (*)(T&, T&)) -> ConcurrentCachedResource<T>;
+
+template<typename F>
+ConcurrentCachedResource(F)
+    -> ConcurrentCachedResource<typename impl::ReducedType<F>::type,
+                                ResourceTraits<typename impl::ReducedType<F>::type>,
+                                F>;
+
+} // namespace sk
+
+#endif // !CONCURRENT_CACHED_RESOURCE_HPP
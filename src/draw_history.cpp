@@ -1,46 +1,136 @@
 #include "draw_history.hpp"
 
+#include <QRect>
+
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <deque>
 #include <iterator>
 #include <optional>
+#include <utility>
+
+namespace {
+
+[[nodiscard]] auto imageBytes(QImage const& image) noexcept -> std::size_t
+{
+    return static_cast<std::size_t>(image.width()) *
+           static_cast<std::size_t>(image.height()) *
+           static_cast<std::size_t>(image.depth()) / 8;
+}
+
+[[nodiscard]] auto tileChanged(QImage const& before,
+                               QImage const& after) noexcept -> bool
+{
+    if(before.isNull() || after.isNull()) {
+        return before.isNull() != after.isNull();
+    }
+
+    // Tiles nothing was painted on are still shared
+    return before.constBits() != after.constBits() && before != after;
+}
+
+} // namespace
 
 namespace sk::impl {
 
-auto CachedLayers::PixmapDrawer(QPixmap& dest, QPixmap& src) -> void
+[[nodiscard]] auto CachedLayers::Traits::sizeOf(TileDelta const& delta) noexcept
+    -> std::size_t
+{
+    std::size_t bytes{ 0 };
+    for(auto const& tile : delta.tiles) {
+        bytes += imageBytes(tile.before) + imageBytes(tile.after);
+    }
+
+    return bytes;
+}
+
+[[nodiscard]] auto CachedLayers::Traits::makeDelta(TiledLayer const& from,
+                                                   TiledLayer const& to)
+    -> TileDelta
+{
+    TileDelta delta{};
+    delta.boundsBefore = from.getBounds();
+    delta.boundsAfter = to.getBounds();
+
+    TiledLayer::forEachTile(from, to, [&](std::size_t const index) -> void {
+        auto const& before = from.getTile(index);
+        auto const& after = to.getTile(index);
+
+        if(tileChanged(before, after)) {
+            delta.tiles.push_back({ index, before, after });
+        }
+    });
+
+    return delta;
+}
+
+auto CachedLayers::Traits::applyDelta(TiledLayer& layer,
+                                      TileDelta const& delta) -> void
+{
+    for(auto const& tile : delta.tiles) {
+        layer.setTile(tile.index, tile.after);
+    }
+    layer.setBounds(delta.boundsAfter);
+}
+
+auto CachedLayers::Traits::revertDelta(TiledLayer& layer,
+                                       TileDelta const& delta) -> void
+{
+    for(auto const& tile : delta.tiles) {
+        layer.setTile(tile.index, tile.before);
+    }
+    layer.setBounds(delta.boundsBefore);
+}
+
+auto CachedLayers::LayerDrawer(TiledLayer& dest, TiledLayer& src) -> void
 {
-    QPainter painter{ &dest };
-    painter.drawPixmap(
-        CachedLayers::m_canvasRect, src, CachedLayers::m_canvasRect);
+    src.drawOnto(dest);
 }
 
-CachedLayers::CachedLayers(bool const foreign)
+CachedLayers::CachedLayers(std::shared_ptr<TilePool> pool, bool const foreign)
     : m_foreign{ foreign }
+    , m_pool{ std::move(pool) }
 {
-    m_layers.emplaceBack(sk::config::width, sk::config::height)
-        .fill(m_transparent);
+    m_layers.emplaceBack(m_pool);
 }
 
 auto CachedLayers::pushNewLayer() -> void
 {
-    m_layers.emplaceBack(sk::config::width, sk::config::height)
-        .fill(m_transparent);
+    m_layers.emplaceBack(m_pool);
 }
 
-auto CachedLayers::paintBlock(QPainter& painter) -> void
+auto CachedLayers::paintBlock(QImage& dest) -> void
 {
-    m_layers.reduceTo([&painter](QPixmap const& src) -> void {
-        painter.drawPixmap(m_canvasRect, src, m_canvasRect);
-    });
+    // Layer by layer on this thread, the parallel replay `associative` traits
+    // enable only covers `reduceTo(T&)`
+    m_layers.reduceTo(
+        [&dest](TiledLayer const& src) -> void { src.drawOnto(dest); });
+}
+
+auto CachedLayers::paintBlock(TiledLayer& dest) -> void
+{
+    m_layers.reduceTo(
+        [&dest](TiledLayer const& src) -> void { src.drawOnto(dest); });
 }
 
-[[nodiscard]] auto CachedLayers::getLastLayer() noexcept -> QPixmap&
+auto CachedLayers::materialize() -> void
+{
+    m_layers.materialize();
+}
+
+auto CachedLayers::fold() -> bool
+{
+    return m_layers.fold();
+}
+
+[[nodiscard]] auto CachedLayers::getLastLayer() noexcept -> TiledLayer&
 {
     return m_layers.getLast();
 }
 
-[[nodiscard]] auto CachedLayers::getLastLayer() const noexcept -> QPixmap const&
+[[nodiscard]] auto CachedLayers::getLastLayer() const noexcept
+    -> TiledLayer const&
 {
     return m_layers.getLast();
 }
@@ -62,11 +152,11 @@ namespace sk {
 auto DrawHistory::CachedDrawer(impl::CachedLayers& dest,
                                impl::CachedLayers& src) -> void
 {
-    QPainter painter{ &dest.getLastLayer() };
-    src.paintBlock(painter);
+    src.paintBlock(dest.getLastLayer());
 }
 
-[[nodiscard]] auto DrawHistory::getLastLayer(bool const foreign) -> QPixmap&
+[[nodiscard]] auto DrawHistory::getLastLayer(bool const foreign)
+    -> TiledLayer&
 {
     return this->getLastLayerIter(foreign).getLastLayer();
 }
@@ -87,27 +177,66 @@ auto DrawHistory::CachedDrawer(impl::CachedLayers& dest,
     return *it;
 }
 
+auto DrawHistory::enforceBudget() -> void
+{
+    auto& blocks = m_layers.getUnderlying();
+
+    while(m_pool->getLentBytes() > m_maxBytes) {
+        if(m_layers.fold()) {
+            continue;
+        }
+
+        auto const folded =
+            std::any_of(blocks.begin(),
+                        blocks.end(),
+                        [](impl::CachedLayers& block) -> bool {
+                            return block.fold();
+                        });
+
+        if(!folded) {
+            break;
+        }
+    }
+}
+
 DrawHistory::DrawHistory()
 {
-    m_layers.emplaceBack();
+    m_layers.emplaceBack(m_pool);
+    m_pool->clean(TiledLayer::tileCount);
 }
 
 auto DrawHistory::pushNewLayer(bool const foreign) -> void
 {
     if(m_layers.getUnderlying().back().foreign() != foreign) {
-        m_layers.emplaceBack(foreign);
+        m_layers.emplaceBack(m_pool, foreign);
     }
     else {
         m_layers.getUnderlying().back().pushNewLayer();
     }
     m_lastPoint = std::nullopt;
+
+    this->enforceBudget();
 }
 
 auto DrawHistory::paintCanvas(QPainter* const painter) -> void
 {
-    m_layers.reduceTo([&painter](impl::CachedLayers& src) -> void {
-        src.paintBlock(*painter);
+    m_canvas.fill(Qt::transparent);
+
+    m_layers.reduceTo([this](impl::CachedLayers& src) -> void {
+        src.paintBlock(m_canvas);
     });
+
+    painter->drawImage(0, 0, m_canvas);
+}
+
+auto DrawHistory::materialize() -> void
+{
+    for(auto& layers : m_layers.getUnderlying()) {
+        layers.materialize();
+    }
+
+    this->enforceBudget();
+    m_pool->clean();
 }
 
 auto DrawHistory::drawAt(QPoint const& pos, QPen const& pen, bool const foreign)
@@ -117,15 +246,22 @@ auto DrawHistory::drawAt(QPoint const& pos, QPen const& pen, bool const foreign)
         last.pushNewLayer();
     }
 
-    QPainter painter{ &this->getLastLayer(foreign) };
-    painter.setPen(pen);
+    // Only the tiles under the segment and its pen get allocated
+    auto const from = m_lastPoint.value_or(pos);
+    auto const margin = static_cast<int>(std::ceil(pen.widthF() / 2.0)) + 1;
+    auto const bounds = QRect{ from, pos }.normalized().adjusted(
+        -margin, -margin, margin, margin);
 
-    if(m_lastPoint.has_value()) {
-        painter.drawLine(m_lastPoint.value(), pos);
-    }
-    else {
-        painter.drawPoint(pos);
-    }
+    this->getLastLayer(foreign).paint(bounds, [&](QPainter& painter) -> void {
+        painter.setPen(pen);
+
+        if(m_lastPoint.has_value()) {
+            painter.drawLine(m_lastPoint.value(), pos);
+        }
+        else {
+            painter.drawPoint(pos);
+        }
+    });
 
     m_lastPoint = pos;
 }
@@ -4,13 +4,19 @@
 
 #include "cached_resource.hpp"
 #include "canvas_config.hpp"
+#include "ring_buffer.hpp"
+#include "tile_pool.hpp"
+#include "tiled_layer.hpp"
 
-#include <QColor>
+#include <QImage>
 #include <QPainter>
-#include <QPixmap>
 #include <QPoint>
+#include <QRect>
 
-#include <deque>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
 
 namespace sk::impl {
 
@@ -18,18 +24,68 @@ class CachedLayers
 {
 private:
     bool const m_foreign{ false };
+    std::shared_ptr<TilePool> m_pool{};
 
-    static auto PixmapDrawer(QPixmap& dest, QPixmap& src) -> void;
+    static auto LayerDrawer(TiledLayer& dest, TiledLayer& src) -> void;
 
-    sk::CachedResource<QPixmap> m_layers{ &PixmapDrawer };
-
-    static constexpr QColor m_transparent{ 0, 0, 0, 0 };
-    static constexpr QRect m_canvasRect{
-        0, 0, sk::config::width, sk::config::height
+    struct Traits
+    {
+        using ContainerType = RingBuffer<TiledLayer>;
+        static constexpr int cacheGap = 5;
+        static constexpr int maxCount = 50;
+        // The tiles live in here, every block of layers gets the budget on
+        // top of the one `DrawHistory` keeps for the whole document. A layer
+        // keeps growing while it's painted on, it's measured again when the
+        // next one is pushed
+        static constexpr std::size_t maxBytes = 64 * 1024 * 1024;
+        static constexpr auto targetLatency = std::chrono::milliseconds{ 2 };
+        // Postponed to idle time, background caches would take the work off
+        // the GUI thread entirely but can't be mixed with either setting yet
+        static constexpr bool lazyCaches = true;
+
+        ///
+        /// The tiles that differ between two neighbouring caches. Strokes in
+        /// a cache gap only touch a few of them so caches are kept this way,
+        /// the whole canvas is only stored for the first one. The tiles are
+        /// shared with the layers they came from.
+        ///
+        struct TileDelta
+        {
+            struct Tile
+            {
+                std::size_t index{ 0 };
+                QImage before{};
+                QImage after{};
+            };
+
+            std::vector<Tile> tiles{};
+            QRect boundsBefore{};
+            QRect boundsAfter{};
+        };
+
+        using DeltaType = TileDelta;
+
+        [[nodiscard]] static auto sizeOf(TiledLayer const& layer) noexcept
+            -> std::size_t
+        {
+            return layer.getBytes();
+        }
+        [[nodiscard]] static auto sizeOf(TileDelta const& delta) noexcept
+            -> std::size_t;
+
+        [[nodiscard]] static auto makeDelta(TiledLayer const& from,
+                                            TiledLayer const& to) -> TileDelta;
+        static auto applyDelta(TiledLayer& layer, TileDelta const& delta)
+            -> void;
+        static auto revertDelta(TiledLayer& layer, TileDelta const& delta)
+            -> void;
     };
 
+    sk::CachedResource<TiledLayer, Traits> m_layers{ &LayerDrawer };
+
 public:
-    explicit CachedLayers(bool const foreign = false);
+    explicit CachedLayers(std::shared_ptr<TilePool> pool,
+                          bool const foreign = false);
     CachedLayers(CachedLayers const&) = default;
     CachedLayers(CachedLayers&&) = default;
     ~CachedLayers() noexcept = default;
@@ -38,9 +94,17 @@ public:
     auto operator=(CachedLayers &&) -> CachedLayers& = delete;
 
     auto pushNewLayer() -> void;
-    auto paintBlock(QPainter& painter) -> void;
-    [[nodiscard]] auto getLastLayer() noexcept -> QPixmap&;
-    [[nodiscard]] auto getLastLayer() const noexcept -> QPixmap const&;
+    auto paintBlock(QImage& dest) -> void;
+    auto paintBlock(TiledLayer& dest) -> void;
+    auto materialize() -> void;
+    ///
+    /// Folds the oldest layers into one.
+    ///
+    /// \returns false If there was nothing left to fold.
+    ///
+    auto fold() -> bool;
+    [[nodiscard]] auto getLastLayer() noexcept -> TiledLayer&;
+    [[nodiscard]] auto getLastLayer() const noexcept -> TiledLayer const&;
 
     [[nodiscard]] constexpr auto foreign() const noexcept -> bool
     {
@@ -72,17 +136,33 @@ private:
 
     struct Traits
     {
-        using ContainerType = std::deque<impl::CachedLayers>;
+        using ContainerType = RingBuffer<impl::CachedLayers>;
         static constexpr int cacheGap = 3;
         static constexpr int maxCount = 50;
     };
 
+    // Bytes of every tile of the document, each one counted once however
+    // many layers and caches share it
+    static constexpr std::size_t m_maxBytes = 256 * 1024 * 1024;
+
+    // Enough idle tiles for two canvases
+    std::shared_ptr<TilePool> m_pool{ TilePool::create(
+        2 * TiledLayer::tileCount) };
     sk::CachedResource<impl::CachedLayers, Traits> m_layers{ &CachedDrawer };
     std::optional<QPoint> m_lastPoint{ std::nullopt };
+    // Every layer is composited in here, then drawn at once
+    QImage m_canvas{ sk::config::width,
+                     sk::config::height,
+                     QImage::Format_ARGB32_Premultiplied };
 
-    [[nodiscard]] auto getLastLayer(bool const foreign = false) -> QPixmap&;
+    [[nodiscard]] auto getLastLayer(bool const foreign = false) -> TiledLayer&;
     [[nodiscard]] auto getLastLayerIter(bool const foreign = false)
         -> impl::CachedLayers&;
+    ///
+    /// Folds until the tiles fit in `m_maxBytes`, whole blocks first and
+    /// then the layers of the oldest blocks that still have some to fold.
+    ///
+    auto enforceBudget() -> void;
 
 public:
     DrawHistory();
@@ -95,6 +175,11 @@ public:
 
     auto pushNewLayer(bool const foreign = false) -> void;
     auto paintCanvas(QPainter* const painter) -> void;
+    ///
+    /// Builds the caches that were postponed while drawing and clears the
+    /// tile buffers freed since. Should be called when the user is idle.
+    ///
+    auto materialize() -> void;
 
     auto drawAt(QPoint const& pos, QPen const& pen, bool const foreign = false)
         -> void;
@@ -0,0 +1,129 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+
+namespace sk {
+
+///
+/// Epoch based reclamation for a single writer and many readers.
+///
+/// A reader pins the domain while it uses what the writer published. The
+/// writer retires what it unlinked at the epoch returned by `advance` and
+/// frees it once `oldestPinned` is past that epoch, so readers never take a
+/// lock and never see memory being freed under them.
+///
+/// Pinning claims one of `maxReaders` slots, it spins while all are taken.
+///
+class EpochDomain
+{
+public:
+    static constexpr std::size_t maxReaders = 64;
+
+private:
+    static constexpr auto m_idle = std::numeric_limits<std::uint64_t>::max();
+
+    // Every slot on its own cache line, readers only ever write their own
+    struct alignas(64) Slot
+    {
+        std::atomic<std::uint64_t> epoch{ m_idle };
+    };
+
+    std::atomic<std::uint64_t> m_epoch{ 0 };
+    std::array<Slot, maxReaders> m_slots{};
+
+public:
+    class Guard
+    {
+    private:
+        std::atomic<std::uint64_t>* m_slot{ nullptr };
+
+    public:
+        explicit Guard(std::atomic<std::uint64_t>* const slot) noexcept
+            : m_slot{ slot }
+        {
+        }
+        Guard(Guard const&) = delete;
+        Guard(Guard&& other) noexcept
+            : m_slot{ std::exchange(other.m_slot, nullptr) }
+        {
+        }
+        ~Guard() noexcept
+        {
+            if(m_slot != nullptr) {
+                m_slot->store(m_idle);
+            }
+        }
+
+        auto operator=(Guard const&) -> Guard& = delete;
+        auto operator=(Guard &&) -> Guard& = delete;
+    };
+
+    EpochDomain() = default;
+    EpochDomain(EpochDomain const&) = delete;
+    EpochDomain(EpochDomain&&) = delete;
+    ~EpochDomain() noexcept = default;
+
+    auto operator=(EpochDomain const&) -> EpochDomain& = delete;
+    auto operator=(EpochDomain &&) -> EpochDomain& = delete;
+
+    ///
+    /// Everything loaded while the guard lives stays valid. Every operation
+    /// here is sequentially consistent: a reader that pins after the writer
+    /// advanced also sees what the writer published before advancing.
+    ///
+    [[nodiscard]] auto pin() noexcept -> Guard
+    {
+        for(;;) {
+            for(auto& slot : m_slots) {
+                auto expected = m_idle;
+
+                if(slot.epoch.load(std::memory_order_relaxed) == m_idle &&
+                   slot.epoch.compare_exchange_strong(expected,
+                                                      m_epoch.load())) {
+                    return Guard{ &slot.epoch };
+                }
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    ///
+    /// Called by the writer after unlinking something.
+    ///
+    /// \returns The epoch to retire it at.
+    ///
+    auto advance() noexcept -> std::uint64_t
+    {
+        return m_epoch.fetch_add(1);
+    }
+
+    ///
+    /// \returns The oldest epoch a reader is pinned at, anything retired
+    ///          before it can be freed. The maximum value when no reader is
+    ///          pinned.
+    ///
+    [[nodiscard]] auto oldestPinned() const noexcept -> std::uint64_t
+    {
+        auto oldest = m_idle;
+
+        for(auto const& slot : m_slots) {
+            oldest = std::min(oldest, slot.epoch.load());
+        }
+
+        return oldest;
+    }
+};
+
+} // namespace sk
+
+#endif // !EPOCH_HPP
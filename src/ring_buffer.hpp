@@ -0,0 +1,568 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sk {
+
+namespace impl {
+
+///
+/// Random access iterator for containers that are indexed from their first
+/// element, it only holds the container and an index into it.
+///
+template<typename Container, bool Const>
+class IndexIterator
+{
+private:
+    using Buffer = std::conditional_t<Const, Container const, Container>;
+    using T = typename Container::value_type;
+
+    Buffer* m_buffer{ nullptr };
+    std::size_t m_index{ 0 };
+
+    template<typename, bool>
+    friend class IndexIterator;
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, T const*, T*>;
+    using reference = std::conditional_t<Const, T const&, T&>;
+
+    IndexIterator() noexcept = default;
+    IndexIterator(Buffer* const buffer, std::size_t const index) noexcept
+        : m_buffer{ buffer }
+        , m_index{ index }
+    {
+    }
+    template<bool C = Const, typename = std::enable_if_t<C>>
+    IndexIterator(IndexIterator<Container, false> const& other) noexcept // NOLINT
+        : m_buffer{ other.m_buffer }
+        , m_index{ other.m_index }
+    {
+    }
+
+    [[nodiscard]] auto index() const noexcept -> std::size_t
+    {
+        return m_index;
+    }
+
+    auto operator*() const -> reference
+    {
+        return (*m_buffer)[m_index];
+    }
+    auto operator->() const -> pointer
+    {
+        return &(*m_buffer)[m_index];
+    }
+    auto operator[](difference_type const n) const -> reference
+    {
+        return *(*this + n);
+    }
+
+    auto operator++() noexcept -> IndexIterator&
+    {
+        ++m_index;
+        return *this;
+    }
+    auto operator++(int) noexcept -> IndexIterator
+    {
+        auto tmp = *this;
+        ++m_index;
+        return tmp;
+    }
+    auto operator--() noexcept -> IndexIterator&
+    {
+        --m_index;
+        return *this;
+    }
+    auto operator--(int) noexcept -> IndexIterator
+    {
+        auto tmp = *this;
+        --m_index;
+        return tmp;
+    }
+
+    auto operator+=(difference_type const n) noexcept -> IndexIterator&
+    {
+        m_index = static_cast<std::size_t>(
+            static_cast<difference_type>(m_index) + n);
+        return *this;
+    }
+    auto operator-=(difference_type const n) noexcept -> IndexIterator&
+    {
+        return *this += -n;
+    }
+
+    friend auto operator+(IndexIterator it, difference_type const n) noexcept
+        -> IndexIterator
+    {
+        return it += n;
+    }
+    friend auto operator+(difference_type const n, IndexIterator it) noexcept
+        -> IndexIterator
+    {
+        return it += n;
+    }
+    friend auto operator-(IndexIterator it, difference_type const n) noexcept
+        -> IndexIterator
+    {
+        return it -= n;
+    }
+    friend auto operator-(IndexIterator const& a,
+                          IndexIterator const& b) noexcept -> difference_type
+    {
+        return static_cast<difference_type>(a.m_index) -
+               static_cast<difference_type>(b.m_index);
+    }
+
+    friend auto operator==(IndexIterator const& a,
+                           IndexIterator const& b) noexcept -> bool
+    {
+        return a.m_index == b.m_index;
+    }
+    friend auto operator!=(IndexIterator const& a,
+                           IndexIterator const& b) noexcept -> bool
+    {
+        return a.m_index != b.m_index;
+    }
+    friend auto operator<(IndexIterator const& a,
+                          IndexIterator const& b) noexcept -> bool
+    {
+        return a.m_index < b.m_index;
+    }
+    friend auto operator>(IndexIterator const& a,
+                          IndexIterator const& b) noexcept -> bool
+    {
+        return a.m_index > b.m_index;
+    }
+    friend auto operator<=(IndexIterator const& a,
+                           IndexIterator const& b) noexcept -> bool
+    {
+        return a.m_index <= b.m_index;
+    }
+    friend auto operator>=(IndexIterator const& a,
+                           IndexIterator const& b) noexcept -> bool
+    {
+        return a.m_index >= b.m_index;
+    }
+};
+
+} // namespace impl
+
+///
+/// Contiguous double ended queue. Elements live in a single power of two
+/// sized buffer and are addressed by an index relative to the first one, so
+/// pushing/popping at either end is O(1) and indexing is a mask away.
+///
+/// Can be used as `ContainerType` for `CachedResource`.
+///
+template<typename T, typename Allocator = std::allocator<T>>
+class RingBuffer
+{
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = T const&;
+
+private:
+    using AllocTraits = std::allocator_traits<Allocator>;
+
+    Allocator m_allocator{};
+    T* m_buffer{ nullptr };
+    size_type m_capacity{ 0 };
+    size_type m_head{ 0 };
+    size_type m_size{ 0 };
+
+    [[nodiscard]] auto slot(size_type const index) const noexcept -> T*
+    {
+        return m_buffer + ((m_head + index) & (m_capacity - 1));
+    }
+
+    [[nodiscard]] auto nextCapacity() const noexcept -> size_type
+    {
+        return (m_capacity == 0) ? 8 : m_capacity * 2;
+    }
+
+    ///
+    /// Moves every element to the start of `buffer` and makes it the storage.
+    /// Elements that can throw while moving are copied, when they can be, so
+    /// that a throw leaves everything as it was, as with `std::vector`.
+    /// `buffer` still belongs to the caller then.
+    ///
+    auto adopt(T* const buffer, size_type const capacity) -> void
+    {
+        size_type moved{ 0 };
+
+        try {
+            for(; moved < m_size; ++moved) {
+                AllocTraits::construct(
+                    m_allocator,
+                    buffer + moved,
+                    std::move_if_noexcept(*this->slot(moved)));
+            }
+        }
+        catch(...) {
+            for(size_type i = 0; i < moved; ++i) {
+                AllocTraits::destroy(m_allocator, buffer + i);
+            }
+            throw;
+        }
+
+        for(size_type i = 0; i < m_size; ++i) {
+            AllocTraits::destroy(m_allocator, this->slot(i));
+        }
+
+        if(m_buffer != nullptr) {
+            AllocTraits::deallocate(m_allocator, m_buffer, m_capacity);
+        }
+
+        m_buffer = buffer;
+        m_capacity = capacity;
+        m_head = 0;
+    }
+
+    ///
+    /// Grows the storage and constructs a new element at the front or at the
+    /// back. The new element is constructed first because `ts` may refer to
+    /// an element that is about to be moved.
+    ///
+    template<bool Front, typename... Ts>
+    auto growAndEmplace(Ts&&... ts) -> void
+    {
+        auto const capacity = this->nextCapacity();
+        T* buffer = AllocTraits::allocate(m_allocator, capacity);
+        auto const position = Front ? capacity - 1 : m_size;
+
+        try {
+            AllocTraits::construct(
+                m_allocator, buffer + position, std::forward<Ts>(ts)...);
+        }
+        catch(...) {
+            AllocTraits::deallocate(m_allocator, buffer, capacity);
+            throw;
+        }
+
+        try {
+            this->adopt(buffer, capacity);
+        }
+        catch(...) {
+            AllocTraits::destroy(m_allocator, buffer + position);
+            AllocTraits::deallocate(m_allocator, buffer, capacity);
+            throw;
+        }
+        m_head = Front ? capacity - 1 : 0;
+        ++m_size;
+    }
+
+    auto release() noexcept -> void
+    {
+        this->clear();
+
+        if(m_buffer != nullptr) {
+            AllocTraits::deallocate(m_allocator, m_buffer, m_capacity);
+        }
+
+        m_buffer = nullptr;
+        m_capacity = 0;
+        m_head = 0;
+    }
+
+public:
+    using iterator = impl::IndexIterator<RingBuffer, false>;
+    using const_iterator = impl::IndexIterator<RingBuffer, true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    RingBuffer() = default;
+    explicit RingBuffer(Allocator const& allocator) noexcept
+        : m_allocator{ allocator }
+    {
+    }
+    RingBuffer(RingBuffer const& other)
+        : m_allocator{ AllocTraits::select_on_container_copy_construction(
+              other.m_allocator) }
+    {
+        for(auto const& value : other) {
+            this->push_back(value);
+        }
+    }
+    RingBuffer(RingBuffer&& other) noexcept
+        : m_allocator{ std::move(other.m_allocator) }
+        , m_buffer{ std::exchange(other.m_buffer, nullptr) }
+        , m_capacity{ std::exchange(other.m_capacity, 0) }
+        , m_head{ std::exchange(other.m_head, 0) }
+        , m_size{ std::exchange(other.m_size, 0) }
+    {
+    }
+    ~RingBuffer() noexcept
+    {
+        this->release();
+    }
+
+    auto operator=(RingBuffer const& other) -> RingBuffer&
+    {
+        if(this != &other) {
+            this->release();
+
+            if constexpr(AllocTraits::propagate_on_container_copy_assignment::
+                             value) {
+                m_allocator = other.m_allocator;
+            }
+
+            for(auto const& value : other) {
+                this->push_back(value);
+            }
+        }
+
+        return *this;
+    }
+    auto operator=(RingBuffer&& other) noexcept(
+        AllocTraits::propagate_on_container_move_assignment::value ||
+        AllocTraits::is_always_equal::value) -> RingBuffer&
+    {
+        if(this == &other) {
+            return *this;
+        }
+
+        this->release();
+
+        if constexpr(AllocTraits::propagate_on_container_move_assignment::
+                         value) {
+            m_allocator = std::move(other.m_allocator);
+        }
+        else if(!(m_allocator == other.m_allocator)) {
+            // The storage can't change hands, move element by element
+            for(auto& value : other) {
+                this->push_back(std::move(value));
+            }
+
+            other.release();
+            return *this;
+        }
+
+        m_buffer = std::exchange(other.m_buffer, nullptr);
+        m_capacity = std::exchange(other.m_capacity, 0);
+        m_head = std::exchange(other.m_head, 0);
+        m_size = std::exchange(other.m_size, 0);
+
+        return *this;
+    }
+
+    [[nodiscard]] auto get_allocator() const noexcept -> allocator_type
+    {
+        return m_allocator;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> size_type
+    {
+        return m_size;
+    }
+    [[nodiscard]] auto empty() const noexcept -> bool
+    {
+        return m_size == 0;
+    }
+    [[nodiscard]] auto capacity() const noexcept -> size_type
+    {
+        return m_capacity;
+    }
+
+    auto reserve(size_type const count) -> void
+    {
+        if(m_capacity >= count) {
+            return;
+        }
+
+        auto capacity = this->nextCapacity();
+        while(capacity < count) {
+            capacity *= 2;
+        }
+
+        T* buffer = AllocTraits::allocate(m_allocator, capacity);
+
+        try {
+            this->adopt(buffer, capacity);
+        }
+        catch(...) {
+            AllocTraits::deallocate(m_allocator, buffer, capacity);
+            throw;
+        }
+    }
+
+    auto operator[](size_type const index) noexcept -> T&
+    {
+        return *this->slot(index);
+    }
+    auto operator[](size_type const index) const noexcept -> T const&
+    {
+        return *this->slot(index);
+    }
+
+    auto front() noexcept -> T&
+    {
+        return *this->slot(0);
+    }
+    auto front() const noexcept -> T const&
+    {
+        return *this->slot(0);
+    }
+    auto back() noexcept -> T&
+    {
+        return *this->slot(m_size - 1);
+    }
+    auto back() const noexcept -> T const&
+    {
+        return *this->slot(m_size - 1);
+    }
+
+    template<typename... Ts>
+    auto emplace_back(Ts&&... ts) -> T&
+    {
+        if(m_size == m_capacity) {
+            this->template growAndEmplace<false>(std::forward<Ts>(ts)...);
+        }
+        else {
+            AllocTraits::construct(
+                m_allocator, this->slot(m_size), std::forward<Ts>(ts)...);
+            ++m_size;
+        }
+
+        return this->back();
+    }
+
+    template<typename... Ts>
+    auto emplace_front(Ts&&... ts) -> T&
+    {
+        if(m_size == m_capacity) {
+            this->template growAndEmplace<true>(std::forward<Ts>(ts)...);
+        }
+        else {
+            auto const head = (m_head + m_capacity - 1) & (m_capacity - 1);
+            AllocTraits::construct(
+                m_allocator, m_buffer + head, std::forward<Ts>(ts)...);
+            m_head = head;
+            ++m_size;
+        }
+
+        return this->front();
+    }
+
+    auto push_back(T const& value) -> void
+    {
+        this->emplace_back(value);
+    }
+    auto push_back(T&& value) -> void
+    {
+        this->emplace_back(std::move(value));
+    }
+    auto push_front(T const& value) -> void
+    {
+        this->emplace_front(value);
+    }
+    auto push_front(T&& value) -> void
+    {
+        this->emplace_front(std::move(value));
+    }
+
+    auto pop_back() noexcept -> void
+    {
+        AllocTraits::destroy(m_allocator, this->slot(m_size - 1));
+        --m_size;
+    }
+    auto pop_front() noexcept -> void
+    {
+        AllocTraits::destroy(m_allocator, this->slot(0));
+        m_head = (m_head + 1) & (m_capacity - 1);
+        --m_size;
+    }
+
+    auto clear() noexcept -> void
+    {
+        while(!this->empty()) {
+            this->pop_back();
+        }
+
+        m_head = 0;
+    }
+
+    auto insert(const_iterator const pos, T value) -> iterator
+    {
+        auto const index = pos.index();
+        this->emplace_back(std::move(value));
+
+        for(auto i = m_size - 1; i > index; --i) {
+            std::swap(*this->slot(i), *this->slot(i - 1));
+        }
+
+        return iterator{ this, index };
+    }
+
+    auto erase(const_iterator const pos) -> iterator
+    {
+        auto const index = pos.index();
+
+        for(auto i = index; i + 1 < m_size; ++i) {
+            *this->slot(i) = std::move(*this->slot(i + 1));
+        }
+
+        this->pop_back();
+        return iterator{ this, index };
+    }
+
+    [[nodiscard]] auto begin() noexcept -> iterator
+    {
+        return iterator{ this, 0 };
+    }
+    [[nodiscard]] auto end() noexcept -> iterator
+    {
+        return iterator{ this, m_size };
+    }
+    [[nodiscard]] auto begin() const noexcept -> const_iterator
+    {
+        return const_iterator{ this, 0 };
+    }
+    [[nodiscard]] auto end() const noexcept -> const_iterator
+    {
+        return const_iterator{ this, m_size };
+    }
+    [[nodiscard]] auto cbegin() const noexcept -> const_iterator
+    {
+        return this->begin();
+    }
+    [[nodiscard]] auto cend() const noexcept -> const_iterator
+    {
+        return this->end();
+    }
+
+    [[nodiscard]] auto rbegin() noexcept -> reverse_iterator
+    {
+        return reverse_iterator{ this->end() };
+    }
+    [[nodiscard]] auto rend() noexcept -> reverse_iterator
+    {
+        return reverse_iterator{ this->begin() };
+    }
+    [[nodiscard]] auto rbegin() const noexcept -> const_reverse_iterator
+    {
+        return const_reverse_iterator{ this->end() };
+    }
+    [[nodiscard]] auto rend() const noexcept -> const_reverse_iterator
+    {
+        return const_reverse_iterator{ this->begin() };
+    }
+};
+
+} // namespace sk
+
+#endif // !RING_BUFFER_HPP
@@ -0,0 +1,397 @@
+#ifndef SPILL_BUFFER_HPP
+#define SPILL_BUFFER_HPP
+#pragma once
+
+#include "ring_buffer.hpp"
+#include "spill_file.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace sk {
+
+///
+/// Double ended queue that keeps at most `Traits::residentBytes` of its
+/// oldest elements in memory, the rest are written to a `SpillFile` and read
+/// back on access. `Traits` has to provide:
+///   - `static auto serialize(T const&, std::vector<std::byte>&) -> void`,
+///     appends the bytes of an element.
+///   - `static auto deserialize(std::byte const*, std::size_t) -> T`.
+///   - `static auto sizeOf(T const&) -> std::size_t`, the memory an element
+///     holds while resident.
+///   - `static constexpr std::size_t residentBytes`.
+///
+/// Nothing is spilled on its own, `trim` has to be called. Accessing a
+/// spilled element brings it back; a non-const access also drops its record
+/// since the element may change, so it's written again the next time it's
+/// spilled. Reads should go through a const reference to keep the record.
+/// References stay valid until the next `trim`.
+///
+/// Copies share the file, each element is written at most once no matter
+/// how many copies hold it. Can be used as `ContainerType` for
+/// `CachedResource`, which trims it to what `reduceTo` doesn't need.
+///
+template<typename T, typename Traits>
+class SpillBuffer
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = T const&;
+    using iterator = impl::IndexIterator<SpillBuffer, false>;
+    using const_iterator = impl::IndexIterator<SpillBuffer, true>;
+
+private:
+    static constexpr std::size_t m_residentLimit = Traits::residentBytes;
+
+    struct Slot
+    {
+        // Empty while spilled
+        std::optional<T> value{};
+        // Bytes accounted in `m_resident` while resident
+        std::size_t bytes{ 0 };
+        // Where the element is in the file, only valid when `written`
+        std::size_t offset{ 0 };
+        std::size_t size{ 0 };
+        bool written{ false };
+    };
+
+    // Faulting elements in doesn't change what the buffer holds, so the
+    // const accessors are allowed to
+    mutable RingBuffer<Slot> m_slots{};
+    mutable std::size_t m_resident{ 0 };
+    // Every element before it is spilled
+    mutable std::size_t m_spillFrom{ 0 };
+
+    std::shared_ptr<SpillFile> m_file{};
+    std::vector<std::byte> m_scratch{};
+
+    auto fault(size_type const index) const -> Slot&
+    {
+        auto& slot = m_slots[index];
+
+        if(!slot.value.has_value()) {
+            slot.value.emplace(
+                Traits::deserialize(m_file->read(slot.offset), slot.size));
+            slot.bytes = Traits::sizeOf(*slot.value);
+            m_resident += slot.bytes;
+            m_spillFrom = std::min(m_spillFrom, index);
+        }
+
+        return slot;
+    }
+
+    auto forget(Slot& slot) noexcept -> void
+    {
+        if(slot.written) {
+            m_file->release(slot.offset);
+            slot.written = false;
+        }
+    }
+
+    auto spill(Slot& slot) -> void
+    {
+        if(!slot.written) {
+            if(!m_file) {
+                m_file = std::make_shared<SpillFile>();
+            }
+
+            m_scratch.clear();
+            Traits::serialize(*slot.value, m_scratch);
+
+            slot.offset = m_file->write(m_scratch.data(), m_scratch.size());
+            slot.size = m_scratch.size();
+            slot.written = true;
+        }
+
+        slot.value.reset();
+        m_resident -= slot.bytes;
+    }
+
+    auto retainAll() noexcept -> void
+    {
+        for(std::size_t i = 0; i < m_slots.size(); ++i) {
+            if(m_slots[i].written) {
+                m_file->retain(m_slots[i].offset);
+            }
+        }
+    }
+
+    auto forgetAll() noexcept -> void
+    {
+        for(std::size_t i = 0; i < m_slots.size(); ++i) {
+            this->forget(m_slots[i]);
+        }
+    }
+
+    [[nodiscard]] static auto makeSlot(T value) -> Slot
+    {
+        auto const bytes = Traits::sizeOf(value);
+        return Slot{ std::optional<T>{ std::move(value) }, bytes };
+    }
+
+public:
+    SpillBuffer() = default;
+    SpillBuffer(SpillBuffer const& other)
+        : m_slots{ other.m_slots }
+        , m_resident{ other.m_resident }
+        , m_spillFrom{ other.m_spillFrom }
+        , m_file{ other.m_file }
+    {
+        this->retainAll();
+    }
+    SpillBuffer(SpillBuffer&& other) noexcept
+        : m_slots{ std::move(other.m_slots) }
+        , m_resident{ std::exchange(other.m_resident, 0) }
+        , m_spillFrom{ std::exchange(other.m_spillFrom, 0) }
+        , m_file{ std::move(other.m_file) }
+    {
+        other.m_slots.clear();
+    }
+    ~SpillBuffer() noexcept
+    {
+        this->forgetAll();
+    }
+
+    auto operator=(SpillBuffer const& other) -> SpillBuffer&
+    {
+        if(this != &other) {
+            auto copy = other;
+            *this = std::move(copy);
+        }
+
+        return *this;
+    }
+    auto operator=(SpillBuffer&& other) noexcept -> SpillBuffer&
+    {
+        if(this != &other) {
+            this->forgetAll();
+
+            m_slots = std::move(other.m_slots);
+            m_resident = std::exchange(other.m_resident, 0);
+            m_spillFrom = std::exchange(other.m_spillFrom, 0);
+            m_file = std::move(other.m_file);
+            other.m_slots.clear();
+        }
+
+        return *this;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> size_type
+    {
+        return m_slots.size();
+    }
+    [[nodiscard]] auto empty() const noexcept -> bool
+    {
+        return m_slots.empty();
+    }
+
+    ///
+    /// \returns The bytes held in memory, as reported by `Traits::sizeOf`.
+    ///
+    [[nodiscard]] auto residentBytes() const noexcept -> std::size_t
+    {
+        return m_resident;
+    }
+    ///
+    /// \returns The bytes of the file that are still referred to, by this
+    ///          buffer or by copies of it.
+    ///
+    [[nodiscard]] auto spilledBytes() const noexcept -> std::size_t
+    {
+        return m_file ? m_file->getLiveBytes() : 0;
+    }
+    ///
+    /// \returns The bytes the file takes, the records still referred to and
+    ///          the holes left between them.
+    ///
+    [[nodiscard]] auto fileBytes() const noexcept -> std::size_t
+    {
+        return m_file ? m_file->getSize() : 0;
+    }
+
+    ///
+    /// Spills elements before `keepFrom`, oldest first, until at most
+    /// `Traits::residentBytes` are left in memory or there's nothing left to
+    /// spill. Elements that were spilled before and haven't changed since
+    /// aren't written again.
+    ///
+    auto trim(size_type const keepFrom) -> void
+    {
+        auto const last = std::min(keepFrom, m_slots.size());
+
+        for(; m_resident > m_residentLimit && m_spillFrom < last;
+            ++m_spillFrom) {
+            auto& slot = m_slots[m_spillFrom];
+
+            if(slot.value.has_value()) {
+                this->spill(slot);
+            }
+        }
+    }
+
+    ///
+    /// Brings `[first, last)` back in memory, after that the const accessors
+    /// can read them from several threads at once. Their records are kept.
+    ///
+    auto fetch(size_type const first, size_type const last) const -> void
+    {
+        for(auto i = first; i < last; ++i) {
+            static_cast<void>(this->fault(i));
+        }
+    }
+
+    auto operator[](size_type const index) -> T&
+    {
+        auto& slot = this->fault(index);
+        this->forget(slot);
+
+        return *slot.value;
+    }
+    auto operator[](size_type const index) const -> T const&
+    {
+        return *this->fault(index).value;
+    }
+
+    auto front() -> T&
+    {
+        return (*this)[0];
+    }
+    auto front() const -> T const&
+    {
+        return (*this)[0];
+    }
+    auto back() -> T&
+    {
+        return (*this)[m_slots.size() - 1];
+    }
+    auto back() const -> T const&
+    {
+        return (*this)[m_slots.size() - 1];
+    }
+
+    template<typename... Ts>
+    auto emplace_back(Ts&&... ts) -> T&
+    {
+        auto& slot = m_slots.emplace_back(makeSlot(T(std::forward<Ts>(ts)...)));
+        m_resident += slot.bytes;
+
+        return *slot.value;
+    }
+    template<typename... Ts>
+    auto emplace_front(Ts&&... ts) -> T&
+    {
+        auto& slot =
+            m_slots.emplace_front(makeSlot(T(std::forward<Ts>(ts)...)));
+        m_resident += slot.bytes;
+        m_spillFrom = 0;
+
+        return *slot.value;
+    }
+
+    auto push_back(T value) -> void
+    {
+        this->emplace_back(std::move(value));
+    }
+    auto push_front(T value) -> void
+    {
+        this->emplace_front(std::move(value));
+    }
+
+    auto pop_back() noexcept -> void
+    {
+        auto& slot = m_slots.back();
+
+        this->forget(slot);
+        if(slot.value.has_value()) {
+            m_resident -= slot.bytes;
+        }
+
+        m_slots.pop_back();
+        m_spillFrom = std::min(m_spillFrom, m_slots.size());
+    }
+    auto pop_front() noexcept -> void
+    {
+        auto& slot = m_slots.front();
+
+        this->forget(slot);
+        if(slot.value.has_value()) {
+            m_resident -= slot.bytes;
+        }
+
+        m_slots.pop_front();
+        m_spillFrom = (m_spillFrom == 0) ? 0 : m_spillFrom - 1;
+    }
+
+    auto clear() noexcept -> void
+    {
+        this->forgetAll();
+        m_slots.clear();
+        m_resident = 0;
+        m_spillFrom = 0;
+    }
+
+    auto insert(const_iterator const pos, T value) -> iterator
+    {
+        auto const index = pos.index();
+        auto slot = makeSlot(std::move(value));
+        m_resident += slot.bytes;
+
+        m_slots.insert(m_slots.begin() + static_cast<difference_type>(index),
+                       std::move(slot));
+        m_spillFrom = std::min(m_spillFrom, index);
+
+        return iterator{ this, index };
+    }
+    auto erase(const_iterator const pos) -> iterator
+    {
+        auto const index = pos.index();
+        auto& slot = m_slots[index];
+
+        this->forget(slot);
+        if(slot.value.has_value()) {
+            m_resident -= slot.bytes;
+        }
+
+        m_slots.erase(m_slots.begin() + static_cast<difference_type>(index));
+        m_spillFrom = std::min(m_spillFrom, index);
+
+        return iterator{ this, index };
+    }
+
+    [[nodiscard]] auto begin() noexcept -> iterator
+    {
+        return iterator{ this, 0 };
+    }
+    [[nodiscard]] auto end() noexcept -> iterator
+    {
+        return iterator{ this, m_slots.size() };
+    }
+    [[nodiscard]] auto begin() const noexcept -> const_iterator
+    {
+        return const_iterator{ this, 0 };
+    }
+    [[nodiscard]] auto end() const noexcept -> const_iterator
+    {
+        return const_iterator{ this, m_slots.size() };
+    }
+    [[nodiscard]] auto cbegin() const noexcept -> const_iterator
+    {
+        return this->begin();
+    }
+    [[nodiscard]] auto cend() const noexcept -> const_iterator
+    {
+        return this->end();
+    }
+};
+
+} // namespace sk
+
+#endif // !SPILL_BUFFER_HPP
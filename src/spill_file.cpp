@@ -0,0 +1,241 @@
+#include "spill_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#endif
+
+namespace {
+
+constexpr std::size_t initialCapacity = 1024 * 1024;
+
+} // namespace
+
+namespace sk {
+
+#ifdef _WIN32
+
+SpillFile::SpillFile()
+{
+    auto const path = std::filesystem::temp_directory_path() /
+                      ("skribble-" + std::to_string(GetCurrentProcessId()) +
+                       "-" + std::to_string(reinterpret_cast<std::uintptr_t>(
+                                 this)) +
+                       ".spill");
+
+    m_file = CreateFileW(path.c_str(),
+                         GENERIC_READ | GENERIC_WRITE,
+                         0,
+                         nullptr,
+                         CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                         nullptr);
+
+    if(m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        throw std::runtime_error{ "Couldn't create a spill file!" };
+    }
+}
+
+SpillFile::~SpillFile() noexcept
+{
+    this->unmap();
+    CloseHandle(m_file);
+}
+
+auto SpillFile::unmap() noexcept -> void
+{
+    if(m_view != nullptr) {
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+    }
+    if(m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+}
+
+auto SpillFile::map(std::size_t const capacity) -> void
+{
+    this->unmap();
+
+    auto const high = static_cast<DWORD>(
+        static_cast<unsigned long long>(capacity) >> 32U);
+    auto const low = static_cast<DWORD>(capacity & 0xFFFFFFFFU);
+
+    // Creating a mapping bigger than the file grows it
+    m_mapping =
+        CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, high, low, nullptr);
+    if(m_mapping == nullptr) {
+        throw std::runtime_error{ "Couldn't grow the spill file!" };
+    }
+
+    m_view = static_cast<std::byte*>(
+        MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity));
+    if(m_view == nullptr) {
+        throw std::runtime_error{ "Couldn't map the spill file!" };
+    }
+
+    m_capacity = capacity;
+}
+
+#else
+
+SpillFile::SpillFile()
+{
+    auto path = (std::filesystem::temp_directory_path() /
+                 "skribble-XXXXXX.spill")
+                    .string();
+
+    m_file = mkstemps(path.data(), 6);
+    if(m_file == -1) {
+        throw std::runtime_error{ "Couldn't create a spill file!" };
+    }
+
+    // The file lives on until it's closed, nobody else should see it
+    unlink(path.c_str());
+}
+
+SpillFile::~SpillFile() noexcept
+{
+    this->unmap();
+    close(m_file);
+}
+
+auto SpillFile::unmap() noexcept -> void
+{
+    if(m_view != nullptr) {
+        munmap(m_view, m_capacity);
+        m_view = nullptr;
+    }
+}
+
+auto SpillFile::map(std::size_t const capacity) -> void
+{
+    this->unmap();
+
+    if(ftruncate(m_file, static_cast<off_t>(capacity)) != 0) {
+        throw std::runtime_error{ "Couldn't grow the spill file!" };
+    }
+
+    auto* const view = mmap(
+        nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if(view == MAP_FAILED) {
+        throw std::runtime_error{ "Couldn't map the spill file!" };
+    }
+
+    m_view = static_cast<std::byte*>(view);
+    m_capacity = capacity;
+}
+
+#endif
+
+[[nodiscard]] auto SpillFile::allocate(std::size_t const size) -> std::size_t
+{
+    if(m_freeBytes >= size) {
+        for(auto it = m_extents.begin(); it != m_extents.end(); ++it) {
+            auto const [offset, extent] = *it;
+
+            if(extent.references != 0 || extent.size < size) {
+                continue;
+            }
+
+            if(extent.size > size) {
+                m_extents.emplace_hint(
+                    std::next(it), offset + size, Extent{ extent.size - size });
+            }
+
+            m_freeBytes -= size;
+            m_extents.erase(it);
+            return offset;
+        }
+    }
+
+    if(m_size + size > m_capacity) {
+        auto capacity = std::max(initialCapacity, m_capacity);
+        while(capacity < m_size + size) {
+            capacity *= 2;
+        }
+
+        this->map(capacity);
+    }
+
+    auto const offset = m_size;
+    m_size += size;
+
+    return offset;
+}
+
+auto SpillFile::write(std::byte const* const data, std::size_t const size)
+    -> std::size_t
+{
+    // Empty records still need an offset of their own
+    auto const extent = std::max(size, std::size_t{ 1 });
+    auto const offset = this->allocate(extent);
+
+    std::memcpy(m_view + offset, data, size);
+    m_extents.emplace(offset, Extent{ extent, 1 });
+    m_liveBytes += extent;
+
+    return offset;
+}
+
+auto SpillFile::read(std::size_t const offset) const noexcept
+    -> std::byte const*
+{
+    return m_view + offset;
+}
+
+auto SpillFile::retain(std::size_t const offset) noexcept -> void
+{
+    ++m_extents.find(offset)->second.references;
+}
+
+auto SpillFile::release(std::size_t const offset) noexcept -> void
+{
+    auto it = m_extents.find(offset);
+    if(--it->second.references > 0) {
+        return;
+    }
+
+    m_liveBytes -= it->second.size;
+    m_freeBytes += it->second.size;
+
+    // Merging only erases, so releasing never allocates
+    if(auto next = std::next(it);
+       next != m_extents.end() && next->second.references == 0) {
+        it->second.size += next->second.size;
+        m_extents.erase(next);
+    }
+    if(it != m_extents.begin()) {
+        if(auto previous = std::prev(it); previous->second.references == 0) {
+            previous->second.size += it->second.size;
+            m_extents.erase(it);
+            it = previous;
+        }
+    }
+
+    // The mapping is kept since it will most likely be needed again
+    if(std::next(it) == m_extents.end()) {
+        m_size = it->first;
+        m_freeBytes -= it->second.size;
+        m_extents.erase(it);
+    }
+}
+
+} // namespace sk
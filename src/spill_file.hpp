@@ -0,0 +1,104 @@
+#ifndef SPILL_FILE_HPP
+#define SPILL_FILE_HPP
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+namespace sk {
+
+///
+/// Anonymous temporary file that is mapped in memory. It's removed when the
+/// object is destroyed.
+///
+/// Records are never moved, so an offset returned by `write` stays valid for
+/// as long as the record is retained. The space of released records is
+/// handed out again by `write`, first fit, and the file only grows when no
+/// hole is big enough.
+///
+class SpillFile
+{
+private:
+#ifdef _WIN32
+    void* m_file{ nullptr };
+    void* m_mapping{ nullptr };
+#else
+    int m_file{ -1 };
+#endif
+    std::byte* m_view{ nullptr };
+    std::size_t m_capacity{ 0 };
+    std::size_t m_size{ 0 };
+    std::size_t m_liveBytes{ 0 };
+    std::size_t m_freeBytes{ 0 };
+
+    struct Extent
+    {
+        std::size_t size{ 0 };
+        // 0 for a hole
+        std::size_t references{ 0 };
+    };
+
+    // Covers `[0, m_size)` without gaps, neighbouring holes are merged and
+    // a hole at the end is cut off
+    std::map<std::size_t, Extent> m_extents{};
+
+    auto unmap() noexcept -> void;
+    auto map(std::size_t const capacity) -> void;
+
+    ///
+    /// \returns Where `size` bytes can be written, the first hole big enough
+    ///          or the end of the file.
+    ///
+    [[nodiscard]] auto allocate(std::size_t const size) -> std::size_t;
+
+public:
+    SpillFile();
+    SpillFile(SpillFile const&) = delete;
+    SpillFile(SpillFile&&) = delete;
+    ~SpillFile() noexcept;
+
+    auto operator=(SpillFile const&) -> SpillFile& = delete;
+    auto operator=(SpillFile &&) -> SpillFile& = delete;
+
+    ///
+    /// Writes a record, growing the file when needed. Pointers returned by
+    /// `read` are invalidated.
+    ///
+    /// \returns The offset of the record. It starts out retained once.
+    ///
+    [[nodiscard]] auto write(std::byte const* data, std::size_t const size)
+        -> std::size_t;
+    [[nodiscard]] auto read(std::size_t const offset) const noexcept
+        -> std::byte const*;
+
+    auto retain(std::size_t const offset) noexcept -> void;
+    ///
+    /// Once a record is released as many times as it was retained its space
+    /// can be reused.
+    ///
+    auto release(std::size_t const offset) noexcept -> void;
+
+    ///
+    /// \returns The number of bytes held by retained records.
+    ///
+    [[nodiscard]] auto getLiveBytes() const noexcept -> std::size_t
+    {
+        return m_liveBytes;
+    }
+    ///
+    /// \returns The number of bytes up to the end of the last record, the
+    ///          live ones and the holes between them.
+    ///
+    [[nodiscard]] auto getSize() const noexcept -> std::size_t
+    {
+        return m_size;
+    }
+    [[nodiscard]] auto getCapacity() const noexcept -> std::size_t
+    {
+        return m_capacity;
+    }
+};
+
+} // namespace sk
+
+#endif // !SPILL_FILE_HPP
@@ -0,0 +1,125 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sk {
+
+class ThreadPool
+{
+private:
+    std::vector<std::thread> m_workers{};
+    std::queue<std::function<void()>> m_tasks{};
+    std::mutex m_mutex{};
+    std::condition_variable m_cv{};
+
+    bool m_stop{ false };
+
+public:
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ~ThreadPool() noexcept
+    {
+        {
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            m_stop = true;
+        }
+
+        m_cv.notify_all();
+
+        for(auto& thread : m_workers) {
+            thread.join();
+        }
+    }
+
+    explicit ThreadPool(
+        std::size_t const numThreads = std::thread::hardware_concurrency())
+    {
+        m_workers.reserve(numThreads);
+
+        for(std::size_t i = 0; i < numThreads; ++i) {
+            m_workers.emplace_back([this]() -> void {
+                for(;;) {
+                    std::function<void()> task{};
+                    {
+                        std::unique_lock<std::mutex> lock{ m_mutex };
+                        m_cv.wait(lock, [this] {
+                            return m_stop || !m_tasks.empty();
+                        });
+
+                        if(m_stop && m_tasks.empty()) {
+                            return;
+                        }
+
+                        task = std::move(m_tasks.front());
+                        m_tasks.pop();
+                    }
+
+                    task();
+                }
+            });
+        }
+    }
+
+    auto operator=(ThreadPool const&) -> ThreadPool& = delete;
+    auto operator=(ThreadPool &&) -> ThreadPool& = delete;
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t
+    {
+        return m_workers.size();
+    }
+
+    template<typename F, typename... Args>
+    auto push(F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<F, Args...>>
+    {
+        using T = std::invoke_result_t<F, Args...>;
+
+        auto task = std::make_shared<std::packaged_task<T()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+        std::future<T> result = task->get_future();
+        {
+            std::unique_lock<std::mutex> lock{ m_mutex };
+
+            if(m_stop) {
+                throw std::runtime_error{
+                    "Attempted to push a thread to a terminated thread pool!"
+                };
+            }
+
+            m_tasks.emplace([task] { (*task)(); });
+        }
+
+        m_cv.notify_one();
+        return result;
+    }
+};
+
+///
+/// \returns A pool shared by everything that runs work in the background. It
+///          lives until the program exits.
+///
+[[nodiscard]] inline auto sharedThreadPool() -> ThreadPool&
+{
+    static ThreadPool pool{ std::max<std::size_t>(
+        1, std::thread::hardware_concurrency()) };
+    return pool;
+}
+
+} // namespace sk
+
+#endif // !THREAD_POOL_HPP
@@ -0,0 +1,119 @@
+#include "tile_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace sk {
+
+auto TilePool::clear(Buffer& buffer) noexcept -> void
+{
+    // Transparent is all zeroes in premultiplied ARGB
+    std::memset(buffer.pixels.get(), 0, m_bufferBytes);
+}
+
+auto TilePool::release(void* const info) noexcept -> void
+{
+    std::unique_ptr<Buffer> buffer{ static_cast<Buffer*>(info) };
+    // Keeps the pool alive until the buffer is back in it
+    auto const pool = std::move(buffer->pool);
+
+    --pool->m_lent;
+
+    std::unique_lock<std::mutex> lock{ pool->m_mutex };
+    // Both have room for the whole capacity so this doesn't allocate
+    if(pool->m_clean.size() + pool->m_dirty.size() < pool->m_capacity) {
+        pool->m_dirty.push_back(std::move(buffer));
+    }
+}
+
+[[nodiscard]] auto TilePool::create(std::size_t const capacity)
+    -> std::shared_ptr<TilePool>
+{
+    std::shared_ptr<TilePool> pool{ new TilePool{} };
+    pool->m_capacity = capacity;
+    pool->m_clean.reserve(capacity);
+    pool->m_dirty.reserve(capacity);
+
+    return pool;
+}
+
+[[nodiscard]] auto TilePool::acquire(int const width, int const height)
+    -> QImage
+{
+    std::unique_ptr<Buffer> buffer{};
+    bool dirty{ true };
+    {
+        std::unique_lock<std::mutex> lock{ m_mutex };
+
+        if(!m_clean.empty()) {
+            buffer = std::move(m_clean.back());
+            m_clean.pop_back();
+            dirty = false;
+        }
+        else if(!m_dirty.empty()) {
+            buffer = std::move(m_dirty.back());
+            m_dirty.pop_back();
+        }
+    }
+
+    if(buffer == nullptr) {
+        buffer = std::make_unique<Buffer>();
+    }
+    if(dirty) {
+        TilePool::clear(*buffer);
+    }
+
+    buffer->pool = this->shared_from_this();
+    ++m_lent;
+
+    auto* const pixels = buffer->pixels.get();
+    auto* const info = buffer.release();
+
+    return QImage{ pixels,
+                   width,
+                   height,
+                   m_bytesPerLine,
+                   QImage::Format_ARGB32_Premultiplied,
+                   &TilePool::release,
+                   info };
+}
+
+auto TilePool::clean(std::size_t const count) -> void
+{
+    std::vector<std::unique_ptr<Buffer>> dirty{};
+    dirty.reserve(m_capacity);
+    {
+        std::unique_lock<std::mutex> lock{ m_mutex };
+        dirty.swap(m_dirty);
+    }
+
+    for(auto& buffer : dirty) {
+        TilePool::clear(*buffer);
+    }
+
+    std::unique_lock<std::mutex> lock{ m_mutex };
+    for(auto& buffer : dirty) {
+        m_clean.push_back(std::move(buffer));
+    }
+
+    auto const target = std::min(count, m_capacity);
+    while(m_clean.size() + m_dirty.size() < target) {
+        auto buffer = std::make_unique<Buffer>();
+        TilePool::clear(*buffer);
+        m_clean.push_back(std::move(buffer));
+    }
+}
+
+[[nodiscard]] auto TilePool::getIdleCount() -> std::size_t
+{
+    std::unique_lock<std::mutex> lock{ m_mutex };
+    return m_clean.size() + m_dirty.size();
+}
+
+[[nodiscard]] auto TilePool::getLentBytes() const noexcept -> std::size_t
+{
+    return m_lent.load() * m_bufferBytes;
+}
+
+} // namespace sk
@@ -0,0 +1,92 @@
+#ifndef TILE_POOL_HPP
+#define TILE_POOL_HPP
+#pragma once
+
+#include "canvas_config.hpp"
+
+#include <QImage>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sk {
+
+///
+/// Recycles the pixel buffers of `TiledLayer` tiles for one document.
+///
+/// `acquire` hands out transparent tiles backed by a pooled buffer. Once the
+/// last copy of such an image is gone the buffer comes back dirty, `clean`
+/// clears those in bulk and should be called when the user is idle so
+/// starting a stroke neither allocates nor clears. A buffer keeps the pool
+/// alive while it's lent out.
+///
+class TilePool : public std::enable_shared_from_this<TilePool>
+{
+private:
+    static constexpr int m_bytesPerLine = sk::config::tileSize * 4;
+    static constexpr auto m_bufferBytes =
+        static_cast<std::size_t>(m_bytesPerLine) *
+        static_cast<std::size_t>(sk::config::tileSize);
+
+    struct Buffer
+    {
+        std::unique_ptr<unsigned char[]> pixels{
+            new unsigned char[m_bufferBytes]
+        };
+        // Only set while the buffer is lent out
+        std::shared_ptr<TilePool> pool{};
+    };
+
+    std::mutex m_mutex{};
+    std::vector<std::unique_ptr<Buffer>> m_clean{};
+    std::vector<std::unique_ptr<Buffer>> m_dirty{};
+    std::size_t m_capacity{ 0 };
+    // Buffers handed out that didn't come back yet
+    std::atomic<std::size_t> m_lent{ 0 };
+
+    static auto clear(Buffer& buffer) noexcept -> void;
+    static auto release(void* info) noexcept -> void;
+
+    TilePool() = default;
+
+public:
+    TilePool(TilePool const&) = delete;
+    TilePool(TilePool&&) = delete;
+    ~TilePool() noexcept = default;
+
+    auto operator=(TilePool const&) -> TilePool& = delete;
+    auto operator=(TilePool &&) -> TilePool& = delete;
+
+    ///
+    /// \param capacity Most idle buffers kept, the rest are freed when they
+    ///                 come back.
+    ///
+    [[nodiscard]] static auto create(std::size_t const capacity)
+        -> std::shared_ptr<TilePool>;
+
+    ///
+    /// \returns A transparent `width` x `height` tile, neither can be bigger
+    ///          than `config::tileSize`.
+    ///
+    [[nodiscard]] auto acquire(int const width, int const height) -> QImage;
+
+    ///
+    /// Clears every buffer that came back since the last call and
+    /// preallocates up to `count` clean ones.
+    ///
+    auto clean(std::size_t const count = 0) -> void;
+
+    [[nodiscard]] auto getIdleCount() -> std::size_t;
+    ///
+    /// \returns The bytes of the buffers lent out, each one counted once no
+    ///          matter how many images share it.
+    ///
+    [[nodiscard]] auto getLentBytes() const noexcept -> std::size_t;
+};
+
+} // namespace sk
+
+#endif // !TILE_POOL_HPP
@@ -0,0 +1,181 @@
+#include "tiled_layer.hpp"
+#include "composite.hpp"
+
+#include <QColor>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+///
+/// Draws `from` of `src` over `dest` at `to`, both premultiplied ARGB32.
+///
+auto compositeRows(QImage& dest,
+                   QPoint const& to,
+                   QImage const& src,
+                   QRect const& from) -> void
+{
+    auto const count = static_cast<std::size_t>(from.width());
+
+    for(int y = 0; y < from.height(); ++y) {
+        auto* const destRow =
+            reinterpret_cast<std::uint32_t*>(dest.scanLine(to.y() + y));
+        auto const* const srcRow = reinterpret_cast<std::uint32_t const*>(
+            src.constScanLine(from.y() + y));
+
+        sk::sourceOver(destRow + to.x(), srcRow + from.x(), count);
+    }
+}
+
+} // namespace
+
+namespace sk {
+
+TiledLayer::TiledLayer(std::shared_ptr<TilePool> pool)
+    : m_pool{ std::move(pool) }
+{
+}
+
+[[nodiscard]] auto TiledLayer::tileRect(std::size_t const index) noexcept
+    -> QRect
+{
+    auto const columns = static_cast<std::size_t>(m_columns);
+    auto const row = static_cast<int>(index / columns);
+    auto const column = static_cast<int>(index % columns);
+
+    return QRect{ column * sk::config::tileSize,
+                  row * sk::config::tileSize,
+                  sk::config::tileSize,
+                  sk::config::tileSize }
+        .intersected(m_canvasRect);
+}
+
+auto TiledLayer::makeGrid() -> void
+{
+    if(m_tiles.empty()) {
+        m_tiles.resize(tileCount);
+    }
+}
+
+auto TiledLayer::tileAt(std::size_t const index) -> QImage&
+{
+    this->makeGrid();
+
+    auto& tile = m_tiles[index];
+    auto const rect = TiledLayer::tileRect(index);
+
+    if(tile.isNull()) {
+        if(m_pool != nullptr) {
+            tile = m_pool->acquire(rect.width(), rect.height());
+        }
+        else {
+            tile = QImage{ rect.width(),
+                           rect.height(),
+                           QImage::Format_ARGB32_Premultiplied };
+            tile.fill(Qt::transparent);
+        }
+    }
+    else if(m_pool != nullptr && !tile.isDetached()) {
+        // Copied into a pooled buffer instead of letting `QImage` detach
+        auto copy = m_pool->acquire(rect.width(), rect.height());
+        auto const length = static_cast<std::size_t>(rect.width()) * 4;
+
+        for(int y = 0; y < rect.height(); ++y) {
+            std::memcpy(copy.scanLine(y), tile.constScanLine(y), length);
+        }
+
+        tile = std::move(copy);
+    }
+    else {
+        // Makes sure layers sharing the tile don't see what's painted on it
+        static_cast<void>(tile.bits());
+    }
+
+    return tile;
+}
+
+auto TiledLayer::drawOnto(QImage& dest) const -> void
+{
+    if(this->empty()) {
+        return;
+    }
+
+    TiledLayer::forEachTile(m_bounds, [&](std::size_t const index) -> void {
+        auto const& tile = m_tiles[index];
+        if(tile.isNull()) {
+            return;
+        }
+
+        auto const rect = TiledLayer::tileRect(index);
+        auto const dirty = rect.intersected(m_bounds);
+
+        compositeRows(
+            dest, dirty.topLeft(), tile, dirty.translated(-rect.topLeft()));
+    });
+}
+
+auto TiledLayer::drawOnto(TiledLayer& dest) const -> void
+{
+    if(this->empty()) {
+        return;
+    }
+
+    dest.makeGrid();
+
+    TiledLayer::forEachTile(m_bounds, [&](std::size_t const index) -> void {
+        auto const& tile = m_tiles[index];
+        if(tile.isNull()) {
+            return;
+        }
+
+        if(dest.m_tiles[index].isNull()) {
+            // Drawing over a transparent tile would just copy it
+            dest.m_tiles[index] = tile;
+            return;
+        }
+
+        auto const rect = TiledLayer::tileRect(index);
+        auto const dirty =
+            rect.intersected(m_bounds).translated(-rect.topLeft());
+
+        compositeRows(dest.tileAt(index), dirty.topLeft(), tile, dirty);
+    });
+
+    dest.m_bounds |= m_bounds;
+}
+
+[[nodiscard]] auto TiledLayer::getTile(std::size_t const index) const noexcept
+    -> QImage const&
+{
+    static QImage const none{};
+
+    return this->empty() ? none : m_tiles[index];
+}
+
+auto TiledLayer::setTile(std::size_t const index, QImage tile) -> void
+{
+    if(tile.isNull() && this->empty()) {
+        return;
+    }
+
+    this->makeGrid();
+    m_tiles[index] = std::move(tile);
+}
+
+[[nodiscard]] auto TiledLayer::getBytes() const noexcept -> std::size_t
+{
+    std::size_t bytes{ 0 };
+    for(auto const& tile : m_tiles) {
+        if(!tile.isNull()) {
+            bytes += static_cast<std::size_t>(tile.width()) *
+                     static_cast<std::size_t>(tile.height()) *
+                     static_cast<std::size_t>(tile.depth()) / 8;
+        }
+    }
+
+    return bytes;
+}
+
+} // namespace sk
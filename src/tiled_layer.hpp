@@ -0,0 +1,179 @@
+#ifndef TILED_LAYER_HPP
+#define TILED_LAYER_HPP
+#pragma once
+
+#include "canvas_config.hpp"
+#include "tile_pool.hpp"
+
+#include <QImage>
+#include <QPainter>
+#include <QRect>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sk {
+
+///
+/// Canvas sized layer split into square tiles of `config::tileSize`. A tile
+/// is only allocated once something is painted on it and so is the grid
+/// itself, an empty layer holds no storage at all and a stroke costs only
+/// the tiles it crosses.
+///
+/// Tiles are `QImage`s, copies of a layer share them until one of the
+/// copies paints on a tile. With a `TilePool` their buffers come from it.
+///
+class TiledLayer
+{
+private:
+    static constexpr int m_columns =
+        (sk::config::width + sk::config::tileSize - 1) / sk::config::tileSize;
+    static constexpr int m_rows =
+        (sk::config::height + sk::config::tileSize - 1) / sk::config::tileSize;
+    static constexpr QRect m_canvasRect{
+        0, 0, sk::config::width, sk::config::height
+    };
+
+    // Null until something is painted on the tile, row by row. Empty until
+    // something is painted on the layer
+    std::vector<QImage> m_tiles{};
+    // Union of everything painted, nothing outside it is drawn
+    QRect m_bounds{};
+    std::shared_ptr<TilePool> m_pool{};
+
+    ///
+    /// Calls `f(std::size_t)` with the index of every tile `rect` touches,
+    /// `rect` has to be within the canvas.
+    ///
+    template<typename F>
+    static auto forEachTile(QRect const& rect, F&& f) -> void
+    {
+        if(rect.isEmpty()) {
+            return;
+        }
+
+        for(int row = rect.top() / sk::config::tileSize;
+            row <= rect.bottom() / sk::config::tileSize;
+            ++row) {
+            for(int column = rect.left() / sk::config::tileSize;
+                column <= rect.right() / sk::config::tileSize;
+                ++column) {
+                f(static_cast<std::size_t>(row) *
+                      static_cast<std::size_t>(m_columns) +
+                  static_cast<std::size_t>(column));
+            }
+        }
+    }
+
+    auto makeGrid() -> void;
+
+    ///
+    /// \returns The tile at `index`, allocated and cleared if it wasn't and
+    ///          not shared with any other layer.
+    ///
+    auto tileAt(std::size_t const index) -> QImage&;
+
+public:
+    static constexpr auto tileCount = static_cast<std::size_t>(m_columns) *
+                                      static_cast<std::size_t>(m_rows);
+
+    explicit TiledLayer(std::shared_ptr<TilePool> pool = nullptr);
+    TiledLayer(TiledLayer const&) = default;
+    TiledLayer(TiledLayer&&) = default;
+    ~TiledLayer() noexcept = default;
+
+    auto operator=(TiledLayer const&) -> TiledLayer& = default;
+    auto operator=(TiledLayer &&) -> TiledLayer& = default;
+
+    ///
+    /// \returns The part of the canvas tile `index` covers, tiles on the
+    ///          right and bottom edges can be smaller than the others.
+    ///
+    [[nodiscard]] static auto tileRect(std::size_t const index) noexcept
+        -> QRect;
+
+    ///
+    /// Calls `f(QPainter&)` once for every tile `bounds` touches with a
+    /// painter in canvas coordinates, allocating the tiles that weren't.
+    /// Whatever `f` paints must stay within `bounds`.
+    ///
+    template<typename F>
+    auto paint(QRect const& bounds, F&& f) -> void
+    {
+        auto const rect = bounds.intersected(m_canvasRect);
+
+        TiledLayer::forEachTile(rect, [&](std::size_t const index) -> void {
+            QPainter painter{ &this->tileAt(index) };
+            painter.translate(-TiledLayer::tileRect(index).topLeft());
+            f(painter);
+        });
+
+        m_bounds |= rect;
+    }
+
+    ///
+    /// Draws what's within the bounds over `dest`, a canvas sized
+    /// `QImage::Format_ARGB32_Premultiplied` image, see `sourceOver`.
+    ///
+    auto drawOnto(QImage& dest) const -> void;
+    ///
+    /// Draws what's within the bounds over `dest`. Tiles `dest` doesn't
+    /// have yet are shared instead of drawn.
+    ///
+    auto drawOnto(TiledLayer& dest) const -> void;
+
+    ///
+    /// \returns true If nothing was painted on the layer, it's skipped when
+    ///          compositing.
+    ///
+    [[nodiscard]] auto empty() const noexcept -> bool
+    {
+        return m_tiles.empty();
+    }
+
+    [[nodiscard]] auto getTile(std::size_t const index) const noexcept
+        -> QImage const&;
+    ///
+    /// Replaces tile `index`, a null image deallocates it. The bounds have
+    /// to be set to match with `setBounds`.
+    ///
+    auto setTile(std::size_t const index, QImage tile) -> void;
+
+    ///
+    /// \returns The union of the rectangles given to `paint` within the
+    ///          canvas, null when nothing was painted.
+    ///
+    [[nodiscard]] auto getBounds() const noexcept -> QRect const&
+    {
+        return m_bounds;
+    }
+    auto setBounds(QRect const& bounds) noexcept -> void
+    {
+        m_bounds = bounds;
+    }
+
+    ///
+    /// Calls `f(std::size_t)` with the index of every tile that lies within
+    /// the bounds of either layer, those are the only ones that can differ.
+    ///
+    template<typename F>
+    static auto forEachTile(TiledLayer const& first,
+                            TiledLayer const& second,
+                            F&& f) -> void
+    {
+        TiledLayer::forEachTile(first.m_bounds | second.m_bounds,
+                                std::forward<F>(f));
+    }
+
+    ///
+    /// \returns The bytes of the allocated tiles, whether they're shared
+    ///          with another layer or not.
+    ///
+    [[nodiscard]] auto getBytes() const noexcept -> std::size_t;
+};
+
+} // namespace sk
+
+#endif // !TILED_LAYER_HPP
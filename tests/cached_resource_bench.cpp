@@ -0,0 +1,215 @@
+#include "bench.hpp"
+#include "cached_resource.hpp"
+#include "format.hpp"
+#include "ring_buffer.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+
+namespace {
+
+std::size_t combines{ 0 };
+
+auto countingAdder(int& dest, int& src) -> void
+{
+    dest += src;
+    ++combines;
+}
+
+template<typename Container>
+struct ContainerTraits
+{
+    using ContainerType = Container;
+    static constexpr int cacheGap = 5;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+};
+
+using Traits = ContainerTraits<std::deque<int>>;
+using RingTraits = ContainerTraits<sk::RingBuffer<int>>;
+
+// Keeps a single running sum instead of caches
+struct InverseTraits : RingTraits
+{
+    static auto inverse(int& dest, int& src) -> void
+    {
+        dest -= src;
+    }
+};
+
+// Long gaps so `reduceTo` is dominated by calls to the reducing function
+struct WideTraits
+{
+    using ContainerType = sk::RingBuffer<int>;
+    static constexpr int cacheGap = 4096;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+};
+
+auto plainAdder(int& dest, int& src) -> void
+{
+    dest += src;
+}
+
+auto inlineAdder = [](int& dest, int& src) -> void { dest += src; };
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int historySize = 10'000;
+constexpr int repetitions = 100;
+
+template<typename T = Traits>
+auto makeHistory() -> sk::CachedResource<int, T>
+{
+    sk::CachedResource<int, T> res{ &countingAdder };
+
+    for(int i = 0; i < historySize; ++i) {
+        res.emplaceBack(i);
+    }
+
+    return res;
+}
+
+auto benchRemoveIf(int const index) -> void
+{
+    std::size_t totalCombines{ 0 };
+    Clock::duration total{};
+
+    for(int i = 0; i < repetitions; ++i) {
+        auto res = makeHistory();
+        combines = 0;
+
+        auto const start = Clock::now();
+        static_cast<void>(
+            res.removeIf([index](int const value) { return value == index; }));
+        total += Clock::now() - start;
+
+        totalCombines += combines;
+    }
+
+    auto const ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(total).count();
+
+    sk::println("removeIf at %1 of %2: %3 combines, %4 ns",
+                index,
+                historySize,
+                totalCombines / repetitions,
+                ns / repetitions);
+}
+
+auto benchFullReduce() -> void
+{
+    auto res = makeHistory();
+    Clock::duration total{};
+    combines = 0;
+
+    for(int i = 0; i < repetitions; ++i) {
+        // Reducing from an empty cache state is what a full rebuild costs
+        int sum{ 0 };
+        auto const start = Clock::now();
+        for(auto& value : res.getUnderlying()) {
+            countingAdder(sum, value);
+        }
+        total += Clock::now() - start;
+    }
+
+    auto const ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(total).count();
+
+    sk::println("full rebuild of %1: %2 combines, %3 ns",
+                historySize,
+                combines / repetitions,
+                ns / repetitions);
+}
+
+///
+/// Walks the whole history back and forth reducing at every step, which is
+/// what the canvas does on each undo/redo.
+///
+template<typename T>
+auto benchUndoRedo(char const* const name) -> void
+{
+    auto res = makeHistory<T>();
+    Clock::duration total{};
+    long long checksum{ 0 };
+    std::size_t steps{ 0 };
+
+    for(int i = 0; i < repetitions / 10; ++i) {
+        auto const start = Clock::now();
+        while(res.undo()) {
+            int sum{ 0 };
+            res.reduceTo(sum);
+            checksum += sum;
+            ++steps;
+        }
+        while(res.redo()) {
+            int sum{ 0 };
+            res.reduceTo(sum);
+            checksum += sum;
+            ++steps;
+        }
+        total += Clock::now() - start;
+    }
+
+    auto const ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(total).count();
+
+    sk::println(
+        "undo/redo + reduceTo with %1: %2 ns per step, %3 bytes (checksum %4)",
+        name,
+        ns / static_cast<long long>(steps),
+        res.getBytes(),
+        checksum);
+}
+
+template<typename Function>
+auto benchReducer(char const* const name, Function function) -> void
+{
+    sk::CachedResource<int, WideTraits, Function> res{ function };
+
+    for(int i = 0; i < WideTraits::cacheGap - 1; ++i) {
+        res.emplaceBack(i);
+    }
+
+    Clock::duration total{};
+    long long checksum{ 0 };
+
+    for(int i = 0; i < repetitions * 10; ++i) {
+        int sum{ 0 };
+        auto const start = Clock::now();
+        res.reduceTo(sum);
+        total += Clock::now() - start;
+        checksum += sum;
+    }
+
+    auto const ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(total).count();
+
+    sk::println("reduceTo over %1 elements with %2: %3 ns (checksum %4)",
+                WideTraits::cacheGap - 1,
+                name,
+                ns / (repetitions * 10),
+                checksum);
+}
+
+} // namespace
+
+auto main(int, char*[]) noexcept -> int
+{
+    warnIfUnoptimized();
+
+    sk::println("cacheGap = %1", Traits::cacheGap);
+
+    benchRemoveIf(historySize - 2);
+    benchRemoveIf(historySize - Traits::cacheGap * 4);
+    benchRemoveIf(historySize / 2);
+    benchRemoveIf(0);
+    benchFullReduce();
+    benchUndoRedo<Traits>("std::deque");
+    benchUndoRedo<RingTraits>("sk::RingBuffer");
+    benchUndoRedo<InverseTraits>("an inverse");
+    benchReducer("a function pointer", &plainAdder);
+    benchReducer("a lambda type", inlineAdder);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+#include "bench.hpp"
+#include "cached_resource.hpp"
+#include "canvas_config.hpp"
+#include "format.hpp"
+#include "ring_buffer.hpp"
+
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+///
+/// Measures `emplaceBack`, `undo`, `redo` and `reduceTo` for every
+/// combination of element type, container and cache gap below, one CSV row
+/// per operation:
+///
+///     element,container,cacheGap,operation,count,nsPerOp,bytes
+///
+/// `bytes` is what `getBytes` reports once the history is built. Rows go to
+/// the file given as the first argument, or to stdout.
+///
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Blob
+{
+    std::array<unsigned char, 4096> bytes{};
+};
+
+///
+/// Element types with the reducing function and history length used for
+/// them. Histories are shorter for the bigger elements so every run takes
+/// about the same time.
+///
+struct IntElement
+{
+    using Type = int;
+    static constexpr char const* name = "int";
+    static constexpr int historySize = 10'000;
+
+    static auto make(int const i) -> int
+    {
+        return i;
+    }
+    static auto reduce(int& dest, int& src) -> void
+    {
+        dest += src;
+    }
+    static auto sizeOf(int const&) -> std::size_t
+    {
+        return sizeof(int);
+    }
+};
+
+struct BlobElement
+{
+    using Type = Blob;
+    static constexpr char const* name = "blob4k";
+    static constexpr int historySize = 2'000;
+
+    static auto make(int const i) -> Blob
+    {
+        Blob blob{};
+        // A stroke only touches part of the blob
+        for(std::size_t j = 0; j < 256; ++j) {
+            blob.bytes[(static_cast<std::size_t>(i) * 97 + j) %
+                       blob.bytes.size()] = static_cast<unsigned char>(i);
+        }
+
+        return blob;
+    }
+    static auto reduce(Blob& dest, Blob& src) -> void
+    {
+        for(std::size_t j = 0; j < dest.bytes.size(); ++j) {
+            dest.bytes[j] = (src.bytes[j] != 0) ? src.bytes[j] : dest.bytes[j];
+        }
+    }
+    static auto sizeOf(Blob const&) -> std::size_t
+    {
+        return sizeof(Blob);
+    }
+};
+
+struct ImageElement
+{
+    using Type = QImage;
+    static constexpr char const* name = "qimage400x600";
+    static constexpr int historySize = 100;
+
+    static auto make(int const i) -> QImage
+    {
+        QImage image{ sk::config::width,
+                      sk::config::height,
+                      QImage::Format_ARGB32_Premultiplied };
+        image.fill(Qt::transparent);
+
+        // Roughly a stroke worth of pixels
+        QPainter painter{ &image };
+        auto const rgb = 0xFF000000U | (static_cast<unsigned>(i) * 2654435761U);
+        painter.fillRect((i * 37) % (sk::config::width - 40),
+                         (i * 53) % (sk::config::height - 40),
+                         40,
+                         40,
+                         QColor::fromRgb(rgb));
+
+        return image;
+    }
+    static auto reduce(QImage& dest, QImage& src) -> void
+    {
+        QPainter painter{ &dest };
+        painter.drawImage(0, 0, src);
+    }
+    static auto sizeOf(QImage const& image) -> std::size_t
+    {
+        return static_cast<std::size_t>(image.width()) *
+               static_cast<std::size_t>(image.height()) *
+               static_cast<std::size_t>(image.depth()) / 8;
+    }
+};
+
+template<typename Element, typename Container, int Gap>
+struct SweepTraits
+{
+    using ContainerType = Container;
+    static constexpr int cacheGap = Gap;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+
+    static auto sizeOf(typename Element::Type const& value) -> std::size_t
+    {
+        return Element::sizeOf(value);
+    }
+};
+
+template<typename Element>
+struct Containers
+{
+    using Deque = std::deque<typename Element::Type>;
+    using Ring = sk::RingBuffer<typename Element::Type>;
+};
+
+struct Row
+{
+    char const* element{ nullptr };
+    char const* container{ nullptr };
+    int cacheGap{ 0 };
+    std::size_t bytes{ 0 };
+};
+
+auto printRow(std::ostream& os,
+              Row const& row,
+              char const* const operation,
+              std::size_t const count,
+              Clock::duration const total) -> void
+{
+    auto const ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(total).count();
+
+    sk::printlnTo(os,
+                  "%1,%2,%3,%4,%5,%6,%7",
+                  row.element,
+                  row.container,
+                  row.cacheGap,
+                  operation,
+                  count,
+                  count == 0 ? 0 : ns / static_cast<long long>(count),
+                  row.bytes);
+}
+
+///
+/// Builds a history, then walks it all the way back and forth reducing at
+/// every step like the canvas does.
+///
+template<typename Element, typename Container, int Gap>
+auto sweepOne(std::ostream& os, char const* const containerName) -> void
+{
+    using T = typename Element::Type;
+    using Traits = SweepTraits<Element, Container, Gap>;
+
+    sk::CachedResource<T, Traits> res{ &Element::reduce };
+
+    Clock::duration emplaceTime{};
+    for(int i = 0; i < Element::historySize; ++i) {
+        auto element = Element::make(i);
+
+        auto const start = Clock::now();
+        res.emplaceBack(std::move(element));
+        emplaceTime += Clock::now() - start;
+    }
+
+    Row const row{ Element::name, containerName, Gap, res.getBytes() };
+
+    Clock::duration undoTime{};
+    Clock::duration redoTime{};
+    Clock::duration reduceTime{};
+    std::size_t undos{ 0 };
+    std::size_t redos{ 0 };
+    std::size_t reduces{ 0 };
+
+    auto const reduce = [&]() -> void {
+        T value{ Element::make(0) };
+
+        auto const start = Clock::now();
+        res.reduceTo(value);
+        reduceTime += Clock::now() - start;
+        ++reduces;
+    };
+
+    for(;;) {
+        auto const start = Clock::now();
+        auto const undone = res.undo();
+        undoTime += Clock::now() - start;
+
+        if(!undone) {
+            break;
+        }
+
+        ++undos;
+        reduce();
+    }
+
+    for(;;) {
+        auto const start = Clock::now();
+        auto const more = res.redo();
+        redoTime += Clock::now() - start;
+        ++redos;
+
+        reduce();
+
+        if(!more) {
+            break;
+        }
+    }
+
+    printRow(os,
+             row,
+             "emplaceBack",
+             static_cast<std::size_t>(Element::historySize),
+             emplaceTime);
+    printRow(os, row, "undo", undos, undoTime);
+    printRow(os, row, "redo", redos, redoTime);
+    printRow(os, row, "reduceTo", reduces, reduceTime);
+}
+
+template<typename Element, int... Gaps>
+auto sweepElement(std::ostream& os, std::integer_sequence<int, Gaps...>)
+    -> void
+{
+    (sweepOne<Element, typename Containers<Element>::Deque, Gaps>(
+         os, "std::deque"),
+     ...);
+    (sweepOne<Element, typename Containers<Element>::Ring, Gaps>(
+         os, "sk::RingBuffer"),
+     ...);
+}
+
+using Gaps = std::integer_sequence<int, 2, 5, 10, 25, 50>;
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int
+{
+    warnIfUnoptimized();
+
+    std::ofstream file{};
+    if(argc > 1) {
+        file.open(argv[1]);
+        if(!file) {
+            sk::printlnTo(std::cerr, "Couldn't open %1", argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto& os = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+
+    sk::printlnTo(
+        os, "element,container,cacheGap,operation,count,nsPerOp,bytes");
+
+    sweepElement<IntElement>(os, Gaps{});
+    sweepElement<BlobElement>(os, Gaps{});
+    sweepElement<ImageElement>(os, Gaps{});
+
+    return EXIT_SUCCESS;
+}
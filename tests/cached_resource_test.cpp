@@ -2,6 +2,16 @@
 #include "test.hpp"
 
 #include "cached_resource.hpp"
+#include "format.hpp"
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
 
 auto adder = [](int& dest, int& src) -> void { dest += src; };
 
@@ -89,3 +99,1268 @@ TEST("[CachedResource] Undo/Redo")
     ASSERT(redo == false);
     ASSERT(res.underUndo() == false);
 }
+
+template<typename T>
+struct BoundedTraits
+{
+    using ContainerType = std::deque<T>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = 10;
+};
+
+TEST("[CachedResource] Max count")
+{
+    sk::CachedResource<int, BoundedTraits<int>> res{ adder };
+
+    for(int i = 0; i < 1000; ++i) {
+        res.emplaceBack(i + 1);
+
+        ASSERT((res.getUnderlying().size() <= 10));
+    }
+
+    ASSERT(res.folded());
+    ASSERT(res.getLast() == 1000);
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum == 500500);
+
+    int undos{ 0 };
+    while(res.undo()) {
+        ++undos;
+    }
+
+    ASSERT(undos == static_cast<int>(res.getUnderlying().size()) - 1);
+
+    sum = 0;
+    res.reduceTo(sum);
+
+    ASSERT(sum == res.getUnderlying().front());
+
+    while(res.redo()) {
+    }
+
+    sum = 0;
+    res.reduceTo(sum);
+
+    ASSERT(sum == 500500);
+}
+
+struct Blob
+{
+    int value{ 0 };
+    std::size_t bytes{ 0 };
+
+    Blob(int const v, std::size_t const b)
+        : value{ v }
+        , bytes{ b }
+    {
+    }
+};
+
+struct BlobTraits
+{
+    using ContainerType = std::deque<Blob>;
+    static constexpr int cacheGap = 4;
+    static constexpr int maxCount = sk::ResourceTraits<Blob>::maxCount;
+    static constexpr std::size_t maxBytes = 1000;
+
+    [[nodiscard]] static auto sizeOf(Blob const& blob) noexcept -> std::size_t
+    {
+        return blob.bytes;
+    }
+};
+
+auto blobAdder = [](Blob& dest, Blob& src) -> void {
+    dest.value += src.value;
+    dest.bytes = std::max(dest.bytes, src.bytes);
+};
+
+TEST("[CachedResource] Max bytes")
+{
+    sk::CachedResource<Blob, BlobTraits> res{ blobAdder };
+
+    for(int i = 0; i < 500; ++i) {
+        res.emplaceBack(i + 1, 10);
+
+        ASSERT((res.getBytes() <= 1000));
+    }
+
+    ASSERT(res.folded());
+
+    std::size_t bytes{ 0 };
+    for(auto const& blob : res.getUnderlying()) {
+        bytes += blob.bytes;
+    }
+    for(int i = 0; i < static_cast<int>(res.getUnderlying().size() - 1) / 4;
+        ++i) {
+        bytes += 10;
+    }
+
+    ASSERT(res.getBytes() == bytes);
+
+    Blob sum{ 0, 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum.value == 125250);
+
+    res.getLast().bytes = 100;
+    res.emplaceBack(1, 10);
+
+    ASSERT((res.getBytes() <= 1000));
+
+    sum = Blob{ 0, 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum.value == 125251);
+}
+
+struct SharedTraits
+{
+    using ContainerType = std::deque<std::shared_ptr<int const>>;
+    static constexpr int cacheGap = 4;
+    static constexpr int maxCount = 1000;
+    static constexpr bool lazyCaches = true;
+};
+
+TEST("[CachedResource] External budget")
+{
+    // Shared by the elements and caches of both resources, each value is
+    // counted once like the tiles of a document
+    std::size_t live{ 0 };
+    auto const make = [&live](int const value) -> std::shared_ptr<int const> {
+        ++live;
+        return { new int{ value }, [&live](int const* const p) -> void {
+                    --live;
+                    delete p;
+                } };
+    };
+    auto const merge = [&make](std::shared_ptr<int const>& dest,
+                               std::shared_ptr<int const>& src) -> void {
+        dest = make(*dest + *src);
+    };
+
+    using Resource = sk::CachedResource<std::shared_ptr<int const>,
+                                        SharedTraits,
+                                        decltype(merge)>;
+    Resource first{ merge };
+    Resource second{ merge };
+
+    constexpr std::size_t budget = 30;
+
+    for(int i = 0; i < 400; ++i) {
+        ((i % 2 == 0) ? first : second).emplaceBack(make(1));
+
+        while(live > budget && (first.fold() || second.fold())) {
+        }
+
+        ASSERT((live <= budget));
+    }
+
+    ASSERT(first.folded());
+    ASSERT(second.folded());
+
+    // What can be redone is kept
+    ASSERT(first.undo());
+    ASSERT(!first.fold());
+
+    auto sum = make(0);
+    first.reduceTo(sum);
+    second.reduceTo(sum);
+
+    ASSERT(*sum == 399);
+}
+
+TEST("[CachedResource] Remove if")
+{
+    sk::CachedResource<int, Traits<int>> res{ adder };
+
+    for(int i = 0; i < 20; ++i) {
+        res.emplaceBack(i + 1);
+    }
+
+    std::size_t calls{ 0 };
+    auto const removed = res.removeIf([&calls](int const value) -> bool {
+        ++calls;
+        return value % 2 == 0;
+    });
+
+    ASSERT(removed == 10);
+    // Every element is looked at once, the first match too
+    ASSERT(calls == 20);
+    ASSERT(res.getUnderlying().size() == 10);
+    ASSERT(res.getLast() == 19);
+    ASSERT((*res.getLastCache()) == 81);
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum == 100);
+
+    for(int i = 0; i < 4; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    ASSERT(res.getLast() == 11);
+    ASSERT((*res.getLastCache()) == 36);
+
+    static_cast<void>(res.removeIf([](int const value) -> bool {
+        return value == 3 || value == 17;
+    }));
+
+    ASSERT(res.underUndo());
+    ASSERT(res.getLast() == 11);
+
+    sum = 0;
+    res.reduceTo(sum);
+
+    ASSERT(sum == 33);
+
+    while(res.redo()) {
+    }
+
+    sum = 0;
+    res.reduceTo(sum);
+
+    ASSERT(sum == 80);
+    ASSERT(res.getLast() == 19);
+
+    res.emplaceBack(1);
+    sum = 0;
+    res.reduceTo(sum);
+
+    ASSERT(sum == 81);
+}
+
+auto slowAdder = [](int& dest, int& src) -> void {
+    auto const start = std::chrono::steady_clock::now();
+    while(std::chrono::steady_clock::now() - start <
+          std::chrono::microseconds{ 10 }) {
+    }
+    dest += src;
+};
+
+struct AdaptiveTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+    static constexpr auto targetLatency = std::chrono::milliseconds{ 1 };
+};
+
+TEST("[CachedResource] Adaptive cache gap")
+{
+    sk::CachedResource<int, AdaptiveTraits> res{ slowAdder };
+
+    for(int i = 0; i < 400; ++i) {
+        res.emplaceBack(i + 1);
+    }
+
+    ASSERT((res.getNsPerByte() > 0.0));
+    ASSERT(!res.getCacheEnds().empty());
+    ASSERT((res.getCacheEnds().size() < 40));
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum == 80200);
+
+    for(int i = 0; i < 150; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    sum = 0;
+    res.reduceTo(sum);
+
+    ASSERT(sum == 31375);
+    ASSERT(res.getLast() == 250);
+}
+
+// Cheap enough that whole histories fit in the target latency
+struct CheapAdaptiveTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 5;
+    static constexpr int maxCount = 50;
+    static constexpr auto targetLatency = std::chrono::milliseconds{ 2 };
+    static constexpr bool lazyCaches = true;
+};
+
+TEST("[CachedResource] Adaptive folding")
+{
+    sk::CachedResource<int, CheapAdaptiveTraits> res{ adder };
+
+    // Caches can't be merged past half of maxCount
+    constexpr std::size_t maxSpacing = 25;
+
+    for(int i = 0; i < 2000; ++i) {
+        auto const before = res.getUnderlying().size();
+        res.emplaceBack(1);
+
+        ASSERT((before + 1 - res.getUnderlying().size() <= maxSpacing + 1));
+        ASSERT((res.getUnderlying().size() <= 50));
+
+        // Idle time, merges caches whenever it can
+        res.materialize();
+    }
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+    ASSERT(sum == 2000);
+
+    // A range counts as a single call
+    std::vector<int> const ones(100, 1);
+    res.emplaceRange(ones.begin(), ones.end());
+
+    auto const& costs = res.getEmplaceCosts();
+    ASSERT(std::accumulate(costs.begin(), costs.end(), std::size_t{ 0 }) ==
+           2001);
+}
+
+struct HierarchicalTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 2;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+    static constexpr bool hierarchical = true;
+};
+
+TEST("[CachedResource] Hierarchical caches")
+{
+    int combines{ 0 };
+    auto counter = [&combines](int& dest, int& src) -> void {
+        dest += src;
+        ++combines;
+    };
+    sk::CachedResource<int, HierarchicalTraits, decltype(counter)> res{ counter };
+
+    constexpr int count = 1024;
+
+    for(int i = 0; i < count; ++i) {
+        res.emplaceBack(i + 1);
+
+        ASSERT((res.getCacheEnds().size() <= 40));
+    }
+
+    combines = 0;
+
+    for(int limit = count - 1; limit >= 0; --limit) {
+        ASSERT(res.undo());
+        ASSERT((res.getCacheEnds().size() <= 40));
+
+        auto const& ends = res.getCacheEnds();
+        auto const nearest =
+            std::upper_bound(ends.begin(), ends.end(), limit);
+        auto const past =
+            (nearest == ends.begin()) ? 0 : *std::prev(nearest);
+
+        ASSERT((limit - static_cast<int>(past) <= 2));
+
+        int sum{ 0 };
+        res.reduceTo(sum);
+
+        ASSERT(sum == limit * (limit + 1) / 2);
+    }
+
+    ASSERT((combines < count * 20));
+
+    for(int limit = 1; limit <= count; ++limit) {
+        static_cast<void>(res.redo());
+
+        int sum{ 0 };
+        res.reduceTo(sum);
+
+        ASSERT(sum == limit * (limit + 1) / 2);
+    }
+}
+
+struct LazyTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+    static constexpr bool lazyCaches = true;
+};
+
+// Counts the calls made on the calling thread only, not the background ones
+thread_local std::size_t callerCombines{ 0 };
+
+auto callerAdder(int& dest, int& src) -> void
+{
+    ++callerCombines;
+    dest += src;
+}
+
+TEST("[CachedResource] Lazy caches")
+{
+    sk::CachedResource<int, LazyTraits> lazy{ callerAdder };
+    sk::CachedResource<int, Traits<int>> eager{ adder };
+
+    callerCombines = 0;
+    for(int i = 0; i < 30; ++i) {
+        lazy.emplaceBack(i + 1);
+        eager.emplaceBack(i + 1);
+    }
+
+    ASSERT(callerCombines == 0);
+    ASSERT(lazy.getEmplaceCosts()[0] == 30);
+    ASSERT(eager.getCacheEnds().size() == 9);
+    ASSERT(lazy.getCacheEnds().empty());
+    ASSERT(lazy.getLastCache() == nullptr);
+
+    int sum{ 0 };
+    lazy.reduceTo(sum);
+
+    ASSERT(sum == 465);
+    ASSERT(lazy.getCacheEnds().size() == 9);
+    ASSERT(lazy.getLastCache() != nullptr);
+    ASSERT((*lazy.getLastCache()) == 378);
+
+    for(int i = 0; i < 10; ++i) {
+        static_cast<void>(lazy.undo());
+    }
+
+    lazy.emplaceBack(100);
+
+    for(int i = 0; i < 5; ++i) {
+        lazy.emplaceBack(1);
+    }
+
+    ASSERT(lazy.getCacheEnds().size() == 6);
+
+    lazy.materialize();
+
+    ASSERT(lazy.getCacheEnds().size() == 8);
+    ASSERT((*lazy.getLastCache()) == 313);
+
+    sum = 0;
+    lazy.reduceTo(sum);
+
+    ASSERT(sum == 315);
+}
+
+struct BackgroundTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+    static constexpr bool backgroundCaches = true;
+};
+
+TEST("[CachedResource] Background caches")
+{
+    sk::CachedResource<int, BackgroundTraits> res{ callerAdder };
+
+    for(int i = 0; i < 300; ++i) {
+        auto const combines = callerCombines;
+        res.emplaceBack(i + 1);
+
+        ASSERT(callerCombines == combines);
+
+        int sum{ 0 };
+        res.reduceTo(sum);
+
+        ASSERT(sum == (i + 1) * (i + 2) / 2);
+    }
+
+    auto const deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+
+    while(res.getCacheEnds().size() < 99 &&
+          std::chrono::steady_clock::now() < deadline) {
+        res.materialize();
+        std::this_thread::yield();
+    }
+
+    ASSERT(res.getCacheEnds().size() == 99);
+    ASSERT(res.getLastCache() != nullptr);
+    ASSERT((*res.getLastCache()) == 44253);
+
+    for(int i = 0; i < 100; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    res.emplaceBack(1);
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum == 20101);
+}
+
+struct LimitedLazyTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = 20;
+    static constexpr bool lazyCaches = true;
+};
+
+struct LimitedBackgroundTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = 20;
+    static constexpr bool backgroundCaches = true;
+};
+
+TEST("[CachedResource] Postponed caches limits")
+{
+    sk::CachedResource<int, LimitedLazyTraits> lazy{ adder };
+    sk::CachedResource<int, LimitedBackgroundTraits> background{ adder };
+
+    // Never materialized, folding has to build the caches it needs
+    for(int i = 0; i < 200; ++i) {
+        lazy.emplaceBack(i + 1);
+        background.emplaceBack(i + 1);
+
+        ASSERT((lazy.getUnderlying().size() <= 20));
+        ASSERT((background.getUnderlying().size() <= 20));
+    }
+
+    std::vector<int> const range(50, 1);
+
+    for(int i = 0; i < 10; ++i) {
+        lazy.emplaceRange(range.begin(), range.end());
+        background.emplaceRange(range.begin(), range.end());
+
+        ASSERT((lazy.getUnderlying().size() <= 20));
+        ASSERT((background.getUnderlying().size() <= 20));
+    }
+
+    int sum{ 0 };
+    lazy.reduceTo(sum);
+
+    ASSERT(sum == 20600);
+
+    sum = 0;
+    background.reduceTo(sum);
+
+    ASSERT(sum == 20600);
+}
+
+struct Multiplier
+{
+    auto operator()(int& dest, int& src) const noexcept -> void
+    {
+        dest *= src;
+    }
+};
+
+auto pointerAdder(int& dest, int& src) -> void
+{
+    dest += src;
+}
+
+TEST("[CachedResource] Functor reducer")
+{
+    sk::CachedResource deduced{ adder };
+    sk::CachedResource pointer{ &pointerAdder };
+    sk::CachedResource<int, Traits<int>, Multiplier> functor{};
+
+    static_assert(
+        std::is_same_v<decltype(deduced),
+                       sk::CachedResource<int,
+                                          sk::ResourceTraits<int>,
+                                          decltype(adder)>>);
+    static_assert(std::is_same_v<decltype(pointer),
+                                 sk::CachedResource<int,
+                                                    sk::ResourceTraits<int>,
+                                                    void (*)(int&, int&)>>);
+
+    for(int i = 0; i < 10; ++i) {
+        deduced.emplaceBack(i + 1);
+        pointer.emplaceBack(i + 1);
+        functor.emplaceBack(i + 1);
+    }
+
+    int sum{ 0 };
+    deduced.reduceTo(sum);
+    ASSERT(sum == 55);
+
+    sum = 0;
+    pointer.reduceTo(sum);
+    ASSERT(sum == 55);
+
+    int product{ 1 };
+    functor.reduceTo(product);
+    ASSERT(product == 3628800);
+
+    static_cast<void>(functor.undo());
+    ASSERT(functor.getLastCache() != nullptr);
+    ASSERT((*functor.getLastCache()) == 362880);
+
+    product = 1;
+    functor.reduceTo(product);
+    ASSERT(product == 362880);
+}
+
+struct AssociativeTraits
+{
+    using ContainerType = std::deque<std::string>;
+    static constexpr int cacheGap = 200;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+    static constexpr bool associative = true;
+    static constexpr std::size_t parallelThreshold = 8;
+};
+
+TEST("[CachedResource] Associative reduction")
+{
+    // Concatenation is associative but not commutative, so the order of the
+    // partial results matters
+    auto concat = [](std::string& dest, std::string& src) -> void {
+        dest += src;
+    };
+
+    sk::CachedResource<std::string, AssociativeTraits, decltype(concat)> res{
+        concat
+    };
+
+    std::string expected{};
+    for(int i = 0; i < 150; ++i) {
+        res.emplaceBack(std::to_string(i) + ",");
+        expected += std::to_string(i) + ",";
+
+        std::string result{ "<" };
+        res.reduceTo(result);
+
+        ASSERT(result == "<" + expected);
+    }
+
+    for(int i = 0; i < 145; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    std::string result{};
+    res.reduceTo(result);
+
+    ASSERT(result == "0,1,2,3,4,");
+}
+
+struct UndoTreeTraits
+{
+    using ContainerType = std::deque<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = sk::ResourceTraits<int>::maxCount;
+    static constexpr bool undoTree = true;
+};
+
+TEST("[CachedResource] Undo tree")
+{
+    int combines{ 0 };
+    auto counter = [&combines](int& dest, int& src) -> void {
+        dest += src;
+        ++combines;
+    };
+    sk::CachedResource<int, UndoTreeTraits, decltype(counter)> res{ counter };
+    auto const sumOf = [&res]() -> int {
+        int sum{ 0 };
+        res.reduceTo(sum);
+        return sum;
+    };
+
+    for(int i = 0; i < 10; ++i) {
+        res.emplaceBack(i + 1);
+    }
+    for(int i = 0; i < 4; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    res.emplaceBack(100);
+
+    ASSERT(sumOf() == 121);
+    ASSERT(res.getBranchCount() == 1);
+    ASSERT(res.getBranchFork(0) == 6);
+
+    // Back to the original line, its caches are still there
+    combines = 0;
+    ASSERT(res.switchBranch(0));
+    ASSERT(sumOf() == 55);
+    ASSERT((combines <= 1 + UndoTreeTraits::cacheGap));
+    ASSERT(res.getBranchCount() == 1);
+    ASSERT(res.underUndo() == false);
+
+    static_cast<void>(res.undo());
+    static_cast<void>(res.undo());
+    res.emplaceBack(200);
+
+    ASSERT(sumOf() == 236);
+    ASSERT(res.getBranchCount() == 2);
+    ASSERT(res.getBranchFork(1) == 8);
+
+    // The branch forking at 8 moves along with the rest of the line
+    ASSERT(res.switchBranch(0));
+    ASSERT(sumOf() == 121);
+    ASSERT(res.getBranchCount() == 1);
+
+    ASSERT(res.switchBranch(0));
+    ASSERT(sumOf() == 236);
+    ASSERT(res.getBranchCount() == 2);
+    ASSERT(res.getBranchFork(1) == 8);
+
+    ASSERT(res.switchBranch(1));
+    ASSERT(sumOf() == 55);
+    ASSERT(res.switchBranch(5) == false);
+
+    static_cast<void>(res.undo());
+    ASSERT(sumOf() == 45);
+    ASSERT(res.redo() == false);
+    ASSERT(sumOf() == 55);
+}
+
+struct BlobTreeTraits
+{
+    using ContainerType = std::deque<Blob>;
+    static constexpr int cacheGap = 4;
+    static constexpr int maxCount = sk::ResourceTraits<Blob>::maxCount;
+    static constexpr std::size_t maxBytes = 1000;
+    static constexpr bool undoTree = true;
+
+    [[nodiscard]] static auto sizeOf(Blob const& blob) noexcept -> std::size_t
+    {
+        return blob.bytes;
+    }
+};
+
+TEST("[CachedResource] Undo tree memory budget")
+{
+    sk::CachedResource<Blob, BlobTreeTraits> res{ blobAdder };
+
+    for(int i = 0; i < 20; ++i) {
+        res.emplaceBack(i + 1, 10);
+    }
+
+    constexpr int cycles = 50;
+    for(int c = 0; c < cycles; ++c) {
+        for(int i = 0; i < 5; ++i) {
+            static_cast<void>(res.undo());
+        }
+        for(int i = 0; i < 5; ++i) {
+            res.emplaceBack(1000 + c, 10);
+            ASSERT((res.getBytes() <= 1000));
+        }
+    }
+
+    // Branches went away before the line had to be folded
+    ASSERT(res.folded() == false);
+
+    auto const kept = static_cast<int>(res.getBranchCount());
+    ASSERT((kept > 1));
+    ASSERT((kept < cycles));
+
+    // Only the most recently abandoned branches are left
+    ASSERT(res.switchBranch(0));
+
+    Blob sum{ 0, 0 };
+    res.reduceTo(sum);
+
+    ASSERT(sum.value == 120 + 5 * (1000 + cycles - 1 - kept));
+}
+
+TEST("[CachedResource] Seek")
+{
+    int combines{ 0 };
+    auto counter = [&combines](int& dest, int& src) -> void {
+        dest += src;
+        ++combines;
+    };
+    sk::CachedResource<int, Traits<int>, decltype(counter)> res{ counter };
+
+    for(int i = 0; i < 300; ++i) {
+        res.emplaceBack(i + 1);
+    }
+
+    for(std::size_t index : { 100U, 0U, 299U, 1U, 150U, 300U, 42U }) {
+        combines = 0;
+
+        ASSERT(res.seek(index));
+        ASSERT(res.getPosition() == index);
+        ASSERT(res.underUndo() == (index < 300));
+
+        int sum{ 0 };
+        res.reduceTo(sum);
+
+        ASSERT(sum == static_cast<int>(index * (index + 1) / 2));
+        ASSERT((combines <= 1 + Traits<int>::cacheGap));
+    }
+
+    ASSERT(res.seek(301) == false);
+    ASSERT(res.getPosition() == 42);
+
+    // Same as getting there through undo
+    ASSERT(res.undo());
+    ASSERT(res.redo());
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+    ASSERT(sum == 903);
+
+    res.emplaceBack(1);
+    ASSERT(res.getUnderlying().size() == 43);
+    ASSERT(res.seek(43));
+    ASSERT(res.redo() == false);
+
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 904);
+}
+
+struct InverseTraits
+{
+    using ContainerType = sk::RingBuffer<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = 100;
+
+    static auto inverse(int& dest, int& src) -> void
+    {
+        dest -= src;
+    }
+};
+
+TEST("[CachedResource] Inverse")
+{
+    int combines{ 0 };
+    auto counter = [&combines](int& dest, int& src) -> void {
+        dest += src;
+        ++combines;
+    };
+    sk::CachedResource<int, InverseTraits, decltype(counter)> res{ counter };
+    auto const sumOf = [&res]() -> int {
+        int sum{ 0 };
+        res.reduceTo(sum);
+        return sum;
+    };
+
+    for(int i = 0; i < 50; ++i) {
+        res.emplaceBack(i + 1);
+    }
+
+    ASSERT(res.getCacheEnds().empty());
+    ASSERT(sumOf() == 1275);
+    ASSERT(res.getLastCache() != nullptr);
+    ASSERT((*res.getLastCache()) == 1225);
+
+    // Every step is a single call, reducing is two
+    combines = 0;
+    for(int i = 0; i < 10; ++i) {
+        ASSERT(res.undo());
+    }
+    ASSERT(combines == 0);
+    ASSERT(sumOf() == 820);
+    ASSERT(combines == 2);
+
+    static_cast<void>(res.redo());
+    ASSERT(sumOf() == 861);
+
+    ASSERT(res.seek(3));
+    ASSERT(sumOf() == 6);
+    ASSERT(res.seek(0));
+    ASSERT(sumOf() == 0);
+    ASSERT(res.getLastCache() == nullptr);
+    ASSERT(res.seek(45));
+    ASSERT(sumOf() == 1035);
+
+    res.emplaceBack(1000);
+    ASSERT(res.getUnderlying().size() == 46);
+    ASSERT(sumOf() == 2035);
+
+    ASSERT(res.removeIf([](int const value) { return value % 2 == 0; }) ==
+           23);
+    ASSERT(sumOf() == 529);
+
+    // Folding keeps the running reduction as it is
+    for(int i = 0; i < 200; ++i) {
+        res.emplaceBack(1);
+    }
+
+    ASSERT(res.folded());
+    ASSERT(res.getUnderlying().size() == 100);
+    ASSERT(sumOf() == 729);
+    ASSERT(res.getBytes() == sizeof(int) * 101);
+
+    while(res.undo()) {
+    }
+    ASSERT(sumOf() == 630);
+}
+
+// A tiny canvas, 0 is transparent
+using Cells = std::vector<int>;
+
+auto paintCells = [](Cells& dest, Cells& src) -> void {
+    for(std::size_t i = 0; i < dest.size(); ++i) {
+        dest[i] = (src[i] != 0) ? src[i] : dest[i];
+    }
+};
+
+struct CellsDelta
+{
+    // Index, before, after
+    std::vector<std::array<int, 3>> cells{};
+};
+
+template<int Gap, bool Hierarchical>
+struct CellsTraits
+{
+    using ContainerType = std::deque<Cells>;
+    static constexpr int cacheGap = Gap;
+    static constexpr int maxCount = 40;
+    static constexpr bool hierarchical = Hierarchical;
+
+    [[nodiscard]] static auto sizeOf(Cells const& cells) noexcept
+        -> std::size_t
+    {
+        return cells.size() * sizeof(int);
+    }
+};
+
+template<int Gap, bool Hierarchical>
+struct DeltaCellsTraits : CellsTraits<Gap, Hierarchical>
+{
+    using DeltaType = CellsDelta;
+    using CellsTraits<Gap, Hierarchical>::sizeOf;
+
+    [[nodiscard]] static auto sizeOf(CellsDelta const& delta) noexcept
+        -> std::size_t
+    {
+        return delta.cells.size() * sizeof(delta.cells.front());
+    }
+
+    [[nodiscard]] static auto makeDelta(Cells const& from, Cells const& to)
+        -> CellsDelta
+    {
+        CellsDelta delta{};
+        for(std::size_t i = 0; i < from.size(); ++i) {
+            if(from[i] != to[i]) {
+                delta.cells.push_back({ static_cast<int>(i), from[i], to[i] });
+            }
+        }
+
+        return delta;
+    }
+
+    static auto applyDelta(Cells& cells, CellsDelta const& delta) -> void
+    {
+        for(auto const& [index, before, after] : delta.cells) {
+            cells[static_cast<std::size_t>(index)] = after;
+        }
+    }
+
+    static auto revertDelta(Cells& cells, CellsDelta const& delta) -> void
+    {
+        for(auto const& [index, before, after] : delta.cells) {
+            cells[static_cast<std::size_t>(index)] = before;
+        }
+    }
+};
+
+TEST("[CachedResource] Delta caches")
+{
+    // Runs the same operations on both and compares every reduction
+    auto const check = [&](auto plain, auto delta) -> void {
+        unsigned seed{ 7 };
+        auto const next = [&seed](unsigned const bound) -> unsigned {
+            seed = seed * 1103515245U + 12345U;
+            return (seed >> 16U) % bound;
+        };
+
+        for(int step = 0; step < 2000; ++step) {
+            auto const op = next(10);
+
+            if(op < 5) {
+                Cells stroke(256, 0);
+                auto const first = next(250);
+                for(auto i = first; i < first + 6; ++i) {
+                    stroke[i] = static_cast<int>(next(9));
+                }
+
+                plain.emplaceBack(stroke);
+                delta.emplaceBack(stroke);
+            }
+            else if(op < 7) {
+                ASSERT(plain.undo() == delta.undo());
+            }
+            else if(op < 9) {
+                ASSERT(plain.redo() == delta.redo());
+            }
+            else if(next(4) == 0) {
+                auto const pred = [](Cells const& cells) -> bool {
+                    return cells[3] == 5;
+                };
+                ASSERT(plain.removeIf(pred) == delta.removeIf(pred));
+            }
+            else {
+                auto const index = next(
+                    static_cast<unsigned>(plain.getUnderlying().size() + 1));
+                ASSERT(plain.seek(index) == delta.seek(index));
+            }
+
+            Cells expected(256, 0);
+            Cells result(256, 0);
+            plain.reduceTo(expected);
+            delta.reduceTo(result);
+
+            ASSERT((result == expected));
+            ASSERT(plain.getCacheEnds().size() == delta.getCacheEnds().size());
+        }
+
+        // Neighbouring caches share most of their cells
+        ASSERT((delta.getBytes() < plain.getBytes()));
+    };
+
+    check(sk::CachedResource<Cells, CellsTraits<3, false>>{ paintCells },
+          sk::CachedResource<Cells, DeltaCellsTraits<3, false>>{ paintCells });
+    check(sk::CachedResource<Cells, CellsTraits<2, true>>{ paintCells },
+          sk::CachedResource<Cells, DeltaCellsTraits<2, true>>{ paintCells });
+}
+
+TEST("[CachedResource] Emplace range")
+{
+    // Same history through emplaceBack and emplaceRange
+    auto const check = [&](auto single, auto batched) -> void {
+        std::vector<int> values(100);
+        for(int i = 0; i < 100; ++i) {
+            values[static_cast<std::size_t>(i)] = i + 1;
+        }
+
+        for(auto const value : values) {
+            single.emplaceBack(value);
+        }
+        batched.emplaceRange(values.begin(), values.begin() + 40);
+        batched.emplaceRange(values.begin() + 40, values.end());
+
+        int expected{ 0 };
+        int result{ 0 };
+        single.reduceTo(expected);
+        batched.reduceTo(result);
+
+        ASSERT(result == expected);
+        ASSERT(batched.getLast() == 100);
+        ASSERT(batched.folded() == single.folded());
+        ASSERT((batched.getCacheEnds().size() <= single.getCacheEnds().size()));
+
+        for(int i = 0; i < 5; ++i) {
+            static_cast<void>(single.undo());
+            static_cast<void>(batched.undo());
+        }
+
+        // Replaces what was undone
+        single.emplaceRange(values.begin(), values.begin() + 3);
+        for(int i = 0; i < 3; ++i) {
+            batched.emplaceBack(values[static_cast<std::size_t>(i)]);
+        }
+
+        expected = 0;
+        result = 0;
+        single.reduceTo(expected);
+        batched.reduceTo(result);
+
+        ASSERT(result == expected);
+        ASSERT(!batched.underUndo());
+    };
+
+    check(sk::CachedResource<int, Traits<int>>{ adder },
+          sk::CachedResource<int, Traits<int>>{ adder });
+    check(sk::CachedResource<int, BoundedTraits<int>>{ adder },
+          sk::CachedResource<int, BoundedTraits<int>>{ adder });
+    check(sk::CachedResource<int, HierarchicalTraits>{ adder },
+          sk::CachedResource<int, HierarchicalTraits>{ adder });
+    check(sk::CachedResource<int, InverseTraits>{ adder },
+          sk::CachedResource<int, InverseTraits>{ adder });
+
+    // A bulk load is a single pass over the elements
+    std::size_t calls{ 0 };
+    auto counter = [&calls](int& dest, int& src) -> void {
+        ++calls;
+        dest += src;
+    };
+
+    std::vector<int> ones(1000, 1);
+    sk::CachedResource<int, Traits<int>, decltype(counter)> res{ counter };
+    res.emplaceRange(ones.begin(), ones.end());
+
+    ASSERT((calls < ones.size()));
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+    ASSERT(sum == 1000);
+}
+
+struct StatisticsTraits
+{
+    using ContainerType = sk::RingBuffer<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = 20;
+    static constexpr bool statistics = true;
+};
+
+struct NoStatisticsTraits : StatisticsTraits
+{
+    static constexpr bool statistics = false;
+};
+
+TEST("[CachedResource] Statistics")
+{
+    // Nothing is stored when disabled, emplace costs come along
+    static_assert(sizeof(sk::CachedResource<int, StatisticsTraits>) ==
+                  sizeof(sk::CachedResource<int, NoStatisticsTraits>) +
+                      sizeof(sk::impl::AllCounters));
+
+    sk::CachedResource<int, StatisticsTraits> res{ adder };
+
+    for(int i = 0; i < 10; ++i) {
+        res.emplaceBack(1);
+    }
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+
+    auto statistics = res.getStatistics();
+    ASSERT(statistics.reduces == 1);
+    // The last cache ends at 9, plus the last element
+    ASSERT(statistics.reduceCombines == 2);
+    ASSERT(statistics.cachesBuilt == 3);
+    ASSERT(statistics.cachesEvicted == 0);
+    ASSERT(statistics.elements == 10);
+    ASSERT(statistics.caches == 3);
+    ASSERT(statistics.cacheBytes == 3 * sizeof(int));
+    ASSERT(statistics.bytes == 13 * sizeof(int));
+
+    for(int i = 0; i < 4; ++i) {
+        static_cast<void>(res.undo());
+    }
+    static_cast<void>(res.redo());
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 7);
+
+    statistics = res.getStatistics();
+    ASSERT(statistics.undos == 4);
+    ASSERT(statistics.redos == 1);
+    ASSERT(statistics.undoDepth == 3);
+    ASSERT(statistics.maxUndoDepth == 4);
+    ASSERT(statistics.maxReduceCombines == 2);
+
+    // Dropping what was undone evicts the cache past it
+    res.emplaceBack(1);
+    statistics = res.getStatistics();
+    ASSERT(statistics.cachesEvicted == 1);
+    ASSERT(statistics.undoDepth == 0);
+
+    auto const text = sk::format("%1", statistics);
+    ASSERT(text.find("reduces=2") != std::string::npos);
+    ASSERT(text.find("cachesEvicted=1") != std::string::npos);
+
+    // Visiting counts the same way
+    sum = 0;
+    res.reduceTo([&sum](int const& value) -> void { sum += value; });
+    ASSERT(sum == 8);
+
+    statistics = res.getStatistics();
+    ASSERT(statistics.reduces == 3);
+    ASSERT(statistics.reduceCombines == 7);
+
+    // Kept along with the statistics, one per emplace
+    auto const& costs = res.getEmplaceCosts();
+    ASSERT(std::accumulate(costs.begin(), costs.end(), std::size_t{ 0 }) ==
+           11);
+
+    res.resetStatistics();
+    ASSERT(res.getStatistics().reduces == 0);
+}
+
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocations{ 0 };
+    std::size_t live{ 0 };
+
+private:
+    auto do_allocate(std::size_t const bytes, std::size_t const alignment)
+        -> void* override
+    {
+        ++allocations;
+        live += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    auto do_deallocate(void* const p,
+                       std::size_t const bytes,
+                       std::size_t const alignment) -> void override
+    {
+        live -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] auto do_is_equal(std::pmr::memory_resource const& other) const
+        noexcept -> bool override
+    {
+        return this == &other;
+    }
+};
+
+TEST("[CachedResource] Memory resource")
+{
+    CountingResource counting{};
+
+    {
+        // Anything that ends up on the default resource throws
+        auto* const previous =
+            std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+        sk::CachedResource<int, sk::pmr::ResourceTraits<int>> res{
+            &pointerAdder, &counting
+        };
+        ASSERT(res.get_allocator().resource() == &counting);
+
+        for(int i = 0; i < 100; ++i) {
+            res.emplaceBack(1);
+        }
+        for(int i = 0; i < 10; ++i) {
+            static_cast<void>(res.undo());
+        }
+        res.emplaceBack(2);
+        ASSERT(res.removeIf([](int const value) { return value == 2; }) == 1);
+
+        int sum{ 0 };
+        res.reduceTo(sum);
+        ASSERT(sum == 90);
+        ASSERT((counting.allocations > 0));
+        ASSERT((counting.live > 0));
+
+        std::pmr::set_default_resource(previous);
+
+        // Copies go to the default resource like the standard containers
+        auto const copy = res;
+        ASSERT(copy.get_allocator().resource() ==
+               std::pmr::get_default_resource());
+    }
+
+    ASSERT(counting.live == 0);
+
+    {
+        // Deallocating is a no-op, everything is given back at once when the
+        // arena goes away
+        std::pmr::monotonic_buffer_resource arena{ &counting };
+        sk::CachedResource<int, sk::pmr::ResourceTraits<int>> history{
+            &pointerAdder, &arena
+        };
+
+        for(int i = 0; i < 1000; ++i) {
+            history.emplaceBack(i);
+        }
+
+        int sum{ 0 };
+        history.reduceTo(sum);
+        ASSERT(sum == 499500);
+
+        auto const allocations = counting.allocations;
+        for(int i = 0; i < 500; ++i) {
+            static_cast<void>(history.undo());
+        }
+        history.emplaceBack(0);
+        ASSERT((counting.allocations - allocations < 5));
+    }
+
+    ASSERT(counting.live == 0);
+}
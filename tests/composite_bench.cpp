@@ -0,0 +1,112 @@
+#include "bench.hpp"
+#include "composite.hpp"
+#include "format.hpp"
+
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+///
+/// Draws a 4K layer over another with `QPainter::drawImage` and with
+/// `sk::sourceOver` one row at a time, the way layers are composited, and
+/// prints the time per frame and the throughput of both.
+///
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int width = 3840;
+constexpr int height = 2160;
+constexpr int repetitions = 50;
+
+///
+/// A layer with transparent, half transparent and opaque parts, roughly
+/// what a few strokes leave.
+///
+auto makeLayer(unsigned const seed) -> QImage
+{
+    QImage image{ width, height, QImage::Format_ARGB32_Premultiplied };
+    image.fill(Qt::transparent);
+
+    QPainter painter{ &image };
+    for(int i = 0; i < 200; ++i) {
+        auto const value = (static_cast<unsigned>(i) + seed) * 2654435761U;
+        auto const alpha = i % 3 == 0 ? 255 : static_cast<int>(value >> 24);
+
+        painter.fillRect(static_cast<int>(value % (width - 400)),
+                         static_cast<int>((value >> 8) % (height - 400)),
+                         400,
+                         400,
+                         QColor{ static_cast<int>(value & 0xFF),
+                                 static_cast<int>((value >> 8) & 0xFF),
+                                 static_cast<int>((value >> 16) & 0xFF),
+                                 alpha });
+    }
+
+    return image;
+}
+
+template<typename F>
+auto measure(char const* const name, QImage const& background, F f)
+    -> Clock::duration
+{
+    auto dest = background;
+    Clock::duration total{};
+
+    for(int i = 0; i < repetitions; ++i) {
+        dest = background;
+        static_cast<void>(dest.bits());
+
+        auto const start = Clock::now();
+        f(dest);
+        total += Clock::now() - start;
+    }
+
+    auto const ms =
+        std::chrono::duration<double, std::milli>(total).count() / repetitions;
+    auto const pixels = static_cast<double>(width) * height;
+
+    sk::println("%1: %2 ms per frame, %3 Mpixel/s",
+                name,
+                ms,
+                pixels / (ms * 1000.0));
+
+    return total;
+}
+
+} // namespace
+
+auto main() -> int
+{
+    warnIfUnoptimized();
+
+    auto const background = makeLayer(1);
+    auto const layer = makeLayer(2);
+
+    sk::println("%1x%2, kernel: %3", width, height, sk::sourceOverKernel());
+
+    auto const painter = measure("QPainter", background, [&](QImage& dest) {
+        QPainter p{ &dest };
+        p.drawImage(0, 0, layer);
+    });
+
+    auto const kernel = measure("sourceOver", background, [&](QImage& dest) {
+        for(int y = 0; y < height; ++y) {
+            sk::sourceOver(
+                reinterpret_cast<std::uint32_t*>(dest.scanLine(y)),
+                reinterpret_cast<std::uint32_t const*>(layer.constScanLine(y)),
+                static_cast<std::size_t>(width));
+        }
+    });
+
+    sk::println("Speedup: %1x",
+                std::chrono::duration<double>(painter).count() /
+                    std::chrono::duration<double>(kernel).count());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include "composite.hpp"
+#include "test.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+///
+/// Random premultiplied pixel, no channel is bigger than its alpha. Some
+/// are transparent or opaque to hit the shortcuts.
+///
+auto randomPixel(std::mt19937& rng) -> std::uint32_t
+{
+    auto const kind = rng() % 4;
+    if(kind == 0) {
+        return 0;
+    }
+
+    auto const alpha =
+        kind == 1 ? 255U : static_cast<std::uint32_t>(rng() % 256);
+    auto pixel = alpha << 24;
+
+    for(std::uint32_t shift = 0; shift < 24; shift += 8) {
+        pixel |= (static_cast<std::uint32_t>(rng()) % (alpha + 1)) << shift;
+    }
+
+    return pixel;
+}
+
+} // namespace
+
+TEST("[Composite] Source over")
+{
+    std::uint32_t dest = 0xFF204060;
+    std::uint32_t src = 0;
+
+    // Transparent keeps, opaque replaces
+    sk::sourceOver(&dest, &src, 1);
+    ASSERT(dest == 0xFF204060);
+
+    src = 0xFF0A0B0C;
+    sk::sourceOver(&dest, &src, 1);
+    ASSERT(dest == 0xFF0A0B0C);
+
+    // Half transparent black halves every channel but alpha
+    dest = 0xFFFFFFFF;
+    src = 0x80000000;
+    sk::sourceOver(&dest, &src, 1);
+    ASSERT(dest == 0xFF7F7F7F);
+}
+
+TEST("[Composite] Same as scalar")
+{
+    std::mt19937 rng{ 42 };
+
+    // Odd lengths and offsets leave tails for every vector width
+    for(std::size_t count = 0; count < 70; ++count) {
+        std::vector<std::uint32_t> src(count + 1);
+        std::vector<std::uint32_t> dest(count + 1);
+
+        for(std::size_t i = 0; i <= count; ++i) {
+            src[i] = randomPixel(rng);
+            dest[i] = randomPixel(rng);
+        }
+
+        auto expected = dest;
+        sk::impl::sourceOverScalar(expected.data() + 1, src.data() + 1, count);
+        sk::sourceOver(dest.data() + 1, src.data() + 1, count);
+
+        ASSERT((dest == expected));
+    }
+}
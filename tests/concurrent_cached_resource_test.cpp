@@ -0,0 +1,132 @@
+#include "concurrent_cached_resource.hpp"
+#include "test.hpp"
+
+#include <atomic>
+#include <thread>
+
+struct ConcurrentTraits
+{
+    static constexpr int cacheGap = 4;
+    static constexpr int maxCount = 30;
+};
+
+TEST("[ConcurrentCachedResource] Undo/Redo")
+{
+    auto adder = [](int& dest, int& src) -> void { dest += src; };
+
+    sk::ConcurrentCachedResource<int, ConcurrentTraits, decltype(adder)> res{
+        adder
+    };
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+    ASSERT(sum == 0);
+
+    for(int i = 1; i <= 10; ++i) {
+        res.emplaceBack(i);
+    }
+
+    res.reduceTo(sum);
+    ASSERT(sum == 55);
+
+    for(int i = 0; i < 3; ++i) {
+        ASSERT(res.undo());
+    }
+
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 28);
+    ASSERT(res.underUndo());
+
+    ASSERT(res.redo());
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 36);
+
+    // Drops 9 and 10
+    res.emplaceBack(100);
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 136);
+    ASSERT(!res.underUndo());
+    ASSERT(!res.redo());
+
+    // Old elements get dropped in a cache gap at a time
+    for(int i = 0; i < 100; ++i) {
+        res.emplaceBack(1);
+    }
+
+    ASSERT(res.folded());
+    ASSERT((res.getPosition() <= 30 + 4));
+
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 236);
+
+    while(res.undo()) {
+    }
+
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT((sum > 0));
+    ASSERT(res.getPosition() == 1);
+}
+
+TEST("[ConcurrentCachedResource] Readers")
+{
+    auto adder = [](long& dest, long& src) -> void { dest += src; };
+
+    sk::ConcurrentCachedResource<long, ConcurrentTraits, decltype(adder)> res{
+        adder
+    };
+
+    std::atomic<bool> done{ false };
+    std::atomic<int> inconsistent{ 0 };
+
+    // The writer only ever publishes versions that hold 1, 2, 3, ..., n
+    // so any sum a reader sees has to be a triangular number
+    auto reader = [&]() -> void {
+        while(!done.load()) {
+            long sum{ 0 };
+            res.reduceTo(sum);
+
+            long n{ 0 };
+            while(n * (n + 1) / 2 < sum) {
+                ++n;
+            }
+            if(n * (n + 1) / 2 != sum) {
+                ++inconsistent;
+            }
+        }
+    };
+
+    std::thread first{ reader };
+    std::thread second{ reader };
+
+    // Stays under maxCount so nothing gets folded into a base
+    for(int round = 0; round < 500; ++round) {
+        long next{ 1 };
+
+        for(int i = 0; next <= 25; ++i) {
+            if(i % 7 == 3 && res.undo()) {
+                --next;
+            }
+            else if(i % 11 == 5 && res.getPosition() > 0) {
+                static_cast<void>(res.undo());
+                static_cast<void>(res.redo());
+            }
+            else {
+                res.emplaceBack(next++);
+            }
+        }
+
+        while(res.undo()) {
+        }
+    }
+
+    done = true;
+    first.join();
+    second.join();
+
+    ASSERT(inconsistent.load() == 0);
+}
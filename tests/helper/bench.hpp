@@ -0,0 +1,23 @@
+#ifndef HELPER_BENCH_HPP
+#define HELPER_BENCH_HPP
+#pragma once
+
+#include "format.hpp"
+
+#include <iostream>
+
+///
+/// Timings of a debug build say nothing about a release one, the default
+/// build type is Debug so the benchmarks warn about it. Goes to `std::cerr`
+/// to keep it out of the results.
+///
+inline auto warnIfUnoptimized() -> void
+{
+#ifndef NDEBUG
+    sk::printlnTo(std::cerr,
+                  "Warning: built without NDEBUG, the timings are "
+                  "meaningless. Configure with -DCMAKE_BUILD_TYPE=Release.");
+#endif
+}
+
+#endif // !HELPER_BENCH_HPP
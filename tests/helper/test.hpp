@@ -124,104 +124,14 @@ auto getTests() -> std::vector<TestBase*>&;
 // #define MAIN_EXECUTABLE
 #ifdef MAIN_EXECUTABLE
 
+#include "thread_pool.hpp"
+
 #include <atomic>
-#include <condition_variable>
 #include <cstdlib>
 #include <filesystem>
-#include <functional>
 #include <future>
-#include <memory>
-#include <queue>
-#include <stdexcept>
-#include <thread>
 #include <utility>
 
-class ThreadPool
-{
-private:
-    std::vector<std::thread> m_workers{};
-    std::queue<std::function<void()>> m_tasks{};
-    std::mutex m_mutex{};
-    std::condition_variable m_cv{};
-
-    bool m_stop{ false };
-
-public:
-    ThreadPool(ThreadPool const&) = delete;
-    ThreadPool(ThreadPool&&) = delete;
-    ~ThreadPool() noexcept
-    {
-        {
-            std::unique_lock<std::mutex> lock{ m_mutex };
-            m_stop = true;
-        }
-
-        m_cv.notify_all();
-
-        for(auto& thread : m_workers) {
-            thread.join();
-        }
-    }
-
-    explicit ThreadPool(
-        std::size_t const numThreads = std::thread::hardware_concurrency())
-    {
-        m_workers.reserve(numThreads);
-
-        for(std::size_t i = 0; i < numThreads; ++i) {
-            m_workers.emplace_back([this]() -> void {
-                for(;;) {
-                    std::function<void()> task{};
-                    {
-                        std::unique_lock<std::mutex> lock{ m_mutex };
-                        m_cv.wait(lock, [this] {
-                            return m_stop || !m_tasks.empty();
-                        });
-
-                        if(m_stop && m_tasks.empty()) {
-                            return;
-                        }
-
-                        task = std::move(m_tasks.front());
-                        m_tasks.pop();
-                    }
-
-                    task();
-                }
-            });
-        }
-    }
-
-    auto operator=(ThreadPool const&) -> ThreadPool& = delete;
-    auto operator=(ThreadPool &&) -> ThreadPool& = delete;
-
-    template<typename F, typename... Args>
-    auto push(F&& f, Args&&... args)
-        -> std::future<std::invoke_result_t<F, Args...>>
-    {
-        using T = std::invoke_result_t<F, Args...>;
-
-        auto task = std::make_shared<std::packaged_task<T()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-
-        std::future<T> result = task->get_future();
-        {
-            std::unique_lock<std::mutex> lock{ m_mutex };
-
-            if(m_stop) {
-                throw std::runtime_error{
-                    "Attempted to push a thread to a terminated thread pool!"
-                };
-            }
-
-            m_tasks.emplace([task] { (*task)(); });
-        }
-
-        m_cv.notify_one();
-        return result;
-    }
-};
-
 auto getTestId() -> int
 {
     static std::atomic<int> id{ 0 };
@@ -266,7 +176,7 @@ auto main(int, char*[]) noexcept -> int
     int ret = EXIT_SUCCESS;
     std::atomic<int> successful{ EXIT_SUCCESS };
     {
-        ThreadPool pool{};
+        sk::ThreadPool pool{};
         std::vector<std::future<void>> workers{};
 
         for(auto& test : getTests()) {
@@ -0,0 +1,246 @@
+#include "ring_buffer.hpp"
+#include "test.hpp"
+
+#include "cached_resource.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+TEST("[RingBuffer] Push/Pop")
+{
+    sk::RingBuffer<int> buffer{};
+
+    ASSERT(buffer.empty());
+
+    for(int i = 0; i < 20; ++i) {
+        buffer.push_back(i);
+    }
+    for(int i = 1; i <= 5; ++i) {
+        buffer.push_front(-i);
+    }
+
+    ASSERT(buffer.size() == 25);
+    ASSERT(buffer.front() == -5);
+    ASSERT(buffer.back() == 19);
+    ASSERT(buffer[5] == 0);
+
+    buffer.pop_front();
+    buffer.pop_back();
+
+    ASSERT(buffer.size() == 23);
+    ASSERT(buffer.front() == -4);
+    ASSERT(buffer.back() == 18);
+
+    buffer.clear();
+    ASSERT(buffer.empty());
+}
+
+TEST("[RingBuffer] Wrap around")
+{
+    sk::RingBuffer<int> buffer{};
+    buffer.reserve(8);
+
+    ASSERT(buffer.capacity() == 8);
+
+    // Keeps the head moving without ever growing
+    for(int i = 0; i < 100; ++i) {
+        buffer.push_back(i);
+        if(buffer.size() > 6) {
+            buffer.pop_front();
+        }
+    }
+
+    ASSERT(buffer.capacity() == 8);
+    ASSERT(buffer.size() == 6);
+
+    for(std::size_t i = 0; i < buffer.size(); ++i) {
+        ASSERT(buffer[i] == static_cast<int>(94 + i));
+    }
+
+    // Growing while wrapped keeps the order
+    for(int i = 100; i < 110; ++i) {
+        buffer.push_back(i);
+    }
+
+    ASSERT(buffer.size() == 16);
+    ASSERT(std::is_sorted(buffer.begin(), buffer.end()));
+    ASSERT(buffer.front() == 94);
+    ASSERT(buffer.back() == 109);
+}
+
+TEST("[RingBuffer] Iterators")
+{
+    sk::RingBuffer<int> buffer{};
+
+    for(int i = 0; i < 10; ++i) {
+        buffer.push_front(i);
+    }
+
+    ASSERT((buffer.end() - buffer.begin()) == 10);
+    ASSERT((*(buffer.begin() + 3)) == 6);
+    ASSERT((*buffer.rbegin()) == 0);
+
+    std::sort(buffer.begin(), buffer.end());
+
+    int expected{ 0 };
+    for(auto const value : buffer) {
+        ASSERT(value == expected++);
+    }
+
+    auto const& constBuffer = buffer;
+    auto const it = std::lower_bound(constBuffer.begin(), constBuffer.end(), 7);
+    ASSERT((it - constBuffer.begin()) == 7);
+}
+
+TEST("[RingBuffer] Insert/Erase")
+{
+    sk::RingBuffer<std::string> buffer{};
+
+    for(int i = 0; i < 5; ++i) {
+        buffer.push_back(std::to_string(i));
+    }
+
+    buffer.insert(buffer.begin() + 2, "x");
+    ASSERT(buffer.size() == 6);
+    ASSERT(buffer[2] == "x");
+    ASSERT(buffer[3] == "2");
+
+    buffer.erase(buffer.begin());
+    ASSERT(buffer.size() == 5);
+    ASSERT(buffer.front() == "1");
+    ASSERT(buffer[1] == "x");
+}
+
+TEST("[RingBuffer] Copy/Move")
+{
+    sk::RingBuffer<std::string> buffer{};
+
+    for(int i = 0; i < 9; ++i) {
+        buffer.push_back(std::string(32, static_cast<char>('a' + i)));
+    }
+
+    // Pushing a reference to an element while growing
+    buffer.push_back(buffer.front());
+    ASSERT(buffer.back() == buffer.front());
+
+    auto copy = buffer;
+    ASSERT(copy.size() == buffer.size());
+    ASSERT(std::equal(copy.begin(), copy.end(), buffer.begin()));
+
+    auto moved = std::move(copy);
+    ASSERT(moved.size() == 10);
+    ASSERT(moved[8] == std::string(32, 'i'));
+
+    copy = moved;
+    moved = std::move(buffer);
+    ASSERT(std::equal(copy.begin(), copy.end(), moved.begin()));
+}
+
+// Copies throw once `copiesLeft` runs out, moves can throw too so growing
+// has to copy
+thread_local int copiesLeft{ 0 };
+
+struct Fragile
+{
+    int value{ 0 };
+
+    explicit Fragile(int const v) noexcept
+        : value{ v }
+    {
+    }
+    Fragile(Fragile const& other)
+        : value{ other.value }
+    {
+        if(copiesLeft-- <= 0) {
+            throw std::runtime_error{ "No copies left" };
+        }
+    }
+    Fragile(Fragile&& other) // NOLINT
+        : Fragile{ static_cast<Fragile const&>(other) }
+    {
+    }
+    ~Fragile() noexcept = default;
+
+    auto operator=(Fragile const&) -> Fragile& = default;
+    auto operator=(Fragile&&) -> Fragile& = default; // NOLINT
+};
+
+TEST("[RingBuffer] Throwing growth")
+{
+    sk::RingBuffer<Fragile> buffer{};
+
+    copiesLeft = 0;
+    for(int i = 0; i < 8; ++i) {
+        buffer.emplace_back(i);
+    }
+
+    // Growing throws half way through, the buffer stays as it was
+    copiesLeft = 4;
+    bool thrown{ false };
+    try {
+        buffer.emplace_back(8);
+    }
+    catch(std::runtime_error const&) {
+        thrown = true;
+    }
+
+    ASSERT(thrown);
+    ASSERT(buffer.size() == 8);
+    for(int i = 0; i < 8; ++i) {
+        ASSERT(buffer[static_cast<std::size_t>(i)].value == i);
+    }
+
+    thrown = false;
+    try {
+        buffer.reserve(100);
+    }
+    catch(std::runtime_error const&) {
+        thrown = true;
+    }
+
+    ASSERT(thrown);
+    ASSERT(buffer.size() == 8);
+
+    copiesLeft = 100;
+    buffer.emplace_back(8);
+    ASSERT(buffer.size() == 9);
+    ASSERT(buffer.back().value == 8);
+}
+
+struct BufferTraits
+{
+    using ContainerType = sk::RingBuffer<int>;
+    static constexpr int cacheGap = 3;
+    static constexpr int maxCount = 20;
+};
+
+TEST("[RingBuffer] CachedResource")
+{
+    auto adder = [](int& dest, int& src) -> void { dest += src; };
+
+    sk::CachedResource<int, BufferTraits> res{ adder };
+
+    for(int i = 0; i < 100; ++i) {
+        res.emplaceBack(1);
+    }
+
+    int sum{ 0 };
+    res.reduceTo(sum);
+    ASSERT(sum == 100);
+    ASSERT((res.getUnderlying().size() <= 20));
+
+    for(int i = 0; i < 10; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 90);
+
+    static_cast<void>(res.redo());
+
+    sum = 0;
+    res.reduceTo(sum);
+    ASSERT(sum == 91);
+}
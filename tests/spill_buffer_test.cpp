@@ -0,0 +1,251 @@
+#include "spill_buffer.hpp"
+#include "test.hpp"
+
+#include "cached_resource.hpp"
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct StringSpill
+{
+    static constexpr std::size_t residentBytes = 256;
+
+    static auto serialize(std::string const& value, std::vector<std::byte>& out)
+        -> void
+    {
+        auto const* const bytes =
+            reinterpret_cast<std::byte const*>(value.data());
+        out.insert(out.end(), bytes, bytes + value.size());
+    }
+
+    static auto deserialize(std::byte const* data, std::size_t const size)
+        -> std::string
+    {
+        return std::string(reinterpret_cast<char const*>(data), size);
+    }
+
+    static auto sizeOf(std::string const& value) -> std::size_t
+    {
+        return value.size();
+    }
+};
+
+TEST("[SpillBuffer] Trim")
+{
+    sk::SpillBuffer<std::string, StringSpill> buffer{};
+
+    for(int i = 0; i < 50; ++i) {
+        buffer.push_back(std::string(32, static_cast<char>('a' + i % 26)));
+    }
+
+    ASSERT(buffer.residentBytes() == 50 * 32);
+    ASSERT(buffer.spilledBytes() == 0);
+
+    // The last 10 have to stay no matter the budget
+    buffer.trim(40);
+    ASSERT(buffer.residentBytes() == 10 * 32);
+    ASSERT(buffer.spilledBytes() == 40 * 32);
+
+    // Reading brings an element back without dropping its record
+    auto const& constBuffer = buffer;
+    ASSERT(constBuffer[3] == std::string(32, 'd'));
+    ASSERT(buffer.residentBytes() == 11 * 32);
+    ASSERT(buffer.spilledBytes() == 40 * 32);
+
+    buffer.trim(40);
+    ASSERT(buffer.residentBytes() == 10 * 32);
+    ASSERT(buffer.spilledBytes() == 40 * 32);
+
+    // Writing drops it
+    buffer[4] += "!";
+    ASSERT(buffer.spilledBytes() == 39 * 32);
+    buffer.trim(40);
+    ASSERT(buffer.spilledBytes() == 39 * 32 + 33);
+    ASSERT(constBuffer[4] == std::string(32, 'e') + "!");
+
+    buffer.pop_front();
+    buffer.pop_back();
+    ASSERT(buffer.size() == 48);
+    ASSERT(constBuffer.front() == std::string(32, 'b'));
+    ASSERT(constBuffer.back() == std::string(32, 'w'));
+}
+
+TEST("[SpillBuffer] Copies")
+{
+    sk::SpillBuffer<std::string, StringSpill> buffer{};
+
+    for(int i = 0; i < 20; ++i) {
+        buffer.push_back(std::to_string(i) + std::string(30, '-'));
+    }
+    buffer.trim(20);
+
+    auto const spilled = buffer.spilledBytes();
+    ASSERT((spilled > 0));
+
+    {
+        auto copy = buffer;
+        ASSERT(copy.size() == 20);
+        ASSERT(copy[0] == "0" + std::string(30, '-'));
+
+        // The copy gave up its record, the original still holds it
+        ASSERT(std::as_const(buffer)[0] == copy[0]);
+    }
+    ASSERT(buffer.spilledBytes() == spilled);
+
+    buffer.clear();
+    ASSERT(buffer.spilledBytes() == 0);
+    ASSERT(buffer.residentBytes() == 0);
+}
+
+struct SpilledTraits
+{
+    using ContainerType = sk::SpillBuffer<std::string, StringSpill>;
+    static constexpr int cacheGap = 4;
+    static constexpr int maxCount = 1000;
+};
+
+TEST("[SpillBuffer] CachedResource")
+{
+    auto concat = [](std::string& dest, std::string& src) -> void {
+        dest += src;
+    };
+
+    sk::CachedResource<std::string, SpilledTraits> res{ concat };
+
+    std::string expected{};
+    for(int i = 0; i < 200; ++i) {
+        auto const element = std::string(8, static_cast<char>('a' + i % 26));
+        res.emplaceBack(element);
+        expected += element;
+    }
+
+    // Only what's past the last cache has to stay resident
+    ASSERT((res.getUnderlying().residentBytes() <= 256 + 8 * 8));
+    ASSERT((res.getUnderlying().spilledBytes() > 0));
+
+    std::string value{};
+    res.reduceTo(value);
+    ASSERT(value == expected);
+
+    for(int i = 0; i < 150; ++i) {
+        static_cast<void>(res.undo());
+    }
+
+    value.clear();
+    res.reduceTo(value);
+    ASSERT(value == expected.substr(0, 50 * 8));
+
+    ASSERT(res.seek(120));
+    value.clear();
+    res.reduceTo(value);
+    ASSERT(value == expected.substr(0, 120 * 8));
+
+    res.emplaceBack("!");
+    value.clear();
+    res.reduceTo(value);
+    ASSERT(value == expected.substr(0, 120 * 8) + "!");
+    ASSERT((res.getUnderlying().residentBytes() <= 256 + 8 * 8));
+}
+
+// Only used by "Reads keep records", the tests run concurrently
+struct CountingSpill : StringSpill
+{
+    static inline std::atomic<int> writes{ 0 };
+
+    static auto serialize(std::string const& value, std::vector<std::byte>& out)
+        -> void
+    {
+        ++writes;
+        StringSpill::serialize(value, out);
+    }
+};
+
+struct CountingTraits
+{
+    using ContainerType = sk::SpillBuffer<std::string, CountingSpill>;
+    static constexpr int cacheGap = 4;
+    static constexpr int maxCount = 1000;
+};
+
+TEST("[SpillBuffer] Reads keep records")
+{
+    auto concat = [](std::string& dest, std::string& src) -> void {
+        dest += src;
+    };
+
+    sk::CachedResource<std::string, CountingTraits> res{ concat };
+
+    for(int i = 0; i < 200; ++i) {
+        res.emplaceBack(std::string(8, static_cast<char>('a' + i % 26)));
+    }
+
+    auto const writes = CountingSpill::writes.load();
+    ASSERT((writes > 0));
+
+    // Replaying spilled elements faults them in, nothing changed so trimming
+    // them again mustn't write them again
+    for(int cycle = 0; cycle < 10; ++cycle) {
+        for(int i = 0; i < 150; ++i) {
+            static_cast<void>(res.undo());
+        }
+
+        std::string value{};
+        res.reduceTo(value);
+        ASSERT(value.size() == 50 * 8);
+
+        for(int i = 0; i < 150; ++i) {
+            static_cast<void>(res.redo());
+        }
+
+        value.clear();
+        res.reduceTo([&value](std::string& element) -> void {
+            value += element;
+        });
+        ASSERT(value.size() == 200 * 8);
+    }
+
+    ASSERT(CountingSpill::writes.load() == writes);
+}
+
+TEST("[SpillBuffer] File reuse")
+{
+    auto concat = [](std::string& dest, std::string& src) -> void {
+        dest += src;
+    };
+
+    sk::CachedResource<std::string, SpilledTraits> res{ concat };
+
+    for(int i = 0; i < 200; ++i) {
+        res.emplaceBack(std::string(8, static_cast<char>('a' + i % 26)));
+    }
+
+    auto const& buffer = res.getUnderlying();
+    auto const size = buffer.fileBytes();
+
+    // Every cycle drops records the next one writes again
+    for(int cycle = 0; cycle < 50; ++cycle) {
+        for(int i = 0; i < 100; ++i) {
+            static_cast<void>(res.undo());
+        }
+
+        std::string value{};
+        res.reduceTo(value);
+        ASSERT(value.size() == 100 * 8);
+
+        for(int i = 0; i < 100; ++i) {
+            res.emplaceBack(std::string(8, static_cast<char>('A' + i % 26)));
+        }
+
+        for(int i = 0; i < 150; ++i) {
+            static_cast<void>(res.undo());
+        }
+        for(int i = 0; i < 150; ++i) {
+            static_cast<void>(res.redo());
+        }
+
+        // Appending instead of filling the holes grows it every cycle
+        ASSERT((buffer.fileBytes() <= 2 * size));
+    }
+}